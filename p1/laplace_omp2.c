@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 // size of plate
 #define COLUMNS    1000
@@ -44,12 +45,24 @@ int main(int argc, char *argv[]) {
 
     int i, j;                                            // grid indexes
     int max_iterations;                                  // number of iterations
+    int opt;                                             // command line option
     int iteration=1;                                     // current iteration
     double dt=100;                                       // largest change in t
     struct timeval start_time, stop_time, elapsed_time;  // timers
 
-    printf("Maximum iterations [100-4000]?\n");
-    scanf("%d", &max_iterations);
+    // -n gives the iteration cap for batch runs, otherwise ask for it
+    max_iterations = 0;
+    while ( (opt = getopt( argc, argv, "n:" )) != -1 ) {
+        if ( opt != 'n' ) {
+            fprintf(stderr, "usage: %s [-n max_iterations]\n", argv[0]);
+            exit(1);
+        }
+        max_iterations = atoi( optarg );
+    }
+    if ( max_iterations <= 0 ) {
+        printf("Maximum iterations [100-4000]?\n");
+        scanf("%d", &max_iterations);
+    }
 
 
     initialize();                   // initialize Temp_last including boundary conditions
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "grid.h"
+
+// Boundary conditions and heat sources for the plate.  Every edge is
+// either Dirichlet (fixed values, written into the boundary cells once)
+// or Neumann (fixed outward difference, boundary cell = neighbouring
+// interior cell + g, rewritten by bc_edges after each sweep).  Either way
+// the sweep kernels only ever read boundary cells, so they stay the same
+// branch free loops; sources just switch the row kernel to one that adds
+// a per cell term to the neighbour sum.
+//
+// Spec file, one directive per line, '#' starts a comment:
+//
+//   top|bottom|left|right  dirichlet  <value>
+//   top|bottom|left|right  dirichlet  ramp <from> <to>
+//   top|bottom|left|right  neumann    <g>
+//   source  <i0> <j0> <i1> <j1> <q>
+//
+// A ramp runs linearly along the edge, from <from> at index 0 to <to> at
+// the last interior index (row `rows` or column `columns`), top/bottom
+// left to right, left/right top to bottom.  A source adds q to the
+// neighbour sum of every cell in rows i0..i1, columns j0..j1.
+
+typedef struct {
+    bc_type_t type;
+    double a, b;        // dirichlet value at index 0 and slope per index; neumann g in a
+} edge_t;
+
+struct boundary {
+    int     rows, columns;
+    edge_t  edge[EDGE_COUNT];
+    grid_t* source;     // NULL when there are no sources
+};
+
+static const char* edge_names[EDGE_COUNT] = { "top", "bottom", "left", "right" };
+
+static void set_ramp( edge_t* e, double from, double to, int n ) {
+    e->type = BC_DIRICHLET;
+    e->a = from;
+    e->b = ( to - from ) / n;
+}
+
+// the plate the drivers have always used: top and left held at 0, right
+// and bottom ramping up to 100 at the bottom right corner
+boundary_t* bc_default( int rows, int columns ) {
+    boundary_t* bc = (boundary_t*)calloc( 1, sizeof(boundary_t) );
+
+    bc->rows    = rows;
+    bc->columns = columns;
+    set_ramp( &bc->edge[EDGE_TOP],    0.0, 0.0,   columns );
+    set_ramp( &bc->edge[EDGE_LEFT],   0.0, 0.0,   rows );
+    set_ramp( &bc->edge[EDGE_RIGHT],  0.0, 100.0, rows );
+    set_ramp( &bc->edge[EDGE_BOTTOM], 0.0, 100.0, columns );
+    return bc;
+}
+
+static void bad_spec( const char* path, int line, const char* text ) {
+    fprintf( stderr, "%s:%d: cannot parse \"%s\"\n", path, line, text );
+    exit(1);
+}
+
+// read a spec file; edges it does not mention keep the default plate's
+boundary_t* bc_load( const char* path, int rows, int columns ) {
+    boundary_t* bc = bc_default( rows, columns );
+    FILE* fp = fopen( path, "r" );
+    char text[256], word[32], kind[32];
+    int line = 0;
+
+    if ( fp == NULL ) {
+        perror( path );
+        exit(1);
+    }
+
+    while ( fgets( text, sizeof(text), fp ) ) {
+        char* hash = strchr( text, '#' );
+        int e, i0, j0, i1, j1, i, j;
+        double x, y;
+
+        line++;
+        if ( hash ) *hash = '\0';
+        text[strcspn( text, "\n" )] = '\0';
+        if ( sscanf( text, "%31s", word ) != 1 ) continue;
+
+        if ( strcmp( word, "source" ) == 0 ) {
+            if ( sscanf( text, "%*s %d %d %d %d %lf", &i0, &j0, &i1, &j1, &x ) != 5
+                 || i0 < 1 || j0 < 1 || i1 > rows || j1 > columns || i0 > i1 || j0 > j1 )
+                bad_spec( path, line, text );
+            if ( bc->source == NULL ) bc->source = grid_alloc( rows, columns );
+            for ( i = i0; i <= i1; i++ )
+                for ( j = j0; j <= j1; j++ )
+                    GRID(bc->source,i,j) += x;
+            continue;
+        }
+
+        for ( e = 0; e < EDGE_COUNT; e++ )
+            if ( strcmp( word, edge_names[e] ) == 0 ) break;
+        if ( e == EDGE_COUNT || sscanf( text, "%*s %31s", kind ) != 1 )
+            bad_spec( path, line, text );
+
+        int n = ( e == EDGE_TOP || e == EDGE_BOTTOM ) ? columns : rows;
+        if ( strcmp( kind, "neumann" ) == 0 && sscanf( text, "%*s %*s %lf", &x ) == 1 ) {
+            bc->edge[e].type = BC_NEUMANN;
+            bc->edge[e].a = x;
+        }
+        else if ( strcmp( kind, "dirichlet" ) == 0 && sscanf( text, "%*s %*s ramp %lf %lf", &x, &y ) == 2 )
+            set_ramp( &bc->edge[e], x, y, n );
+        else if ( strcmp( kind, "dirichlet" ) == 0 && sscanf( text, "%*s %*s %lf", &x ) == 1 )
+            set_ramp( &bc->edge[e], x, x, n );
+        else
+            bad_spec( path, line, text );
+    }
+
+    fclose( fp );
+    return bc;
+}
+
+void bc_free( boundary_t* bc ) {
+    if ( bc->source ) grid_free( bc->source );
+    free( bc );
+}
+
+// 1 if the spec needs more than fixed boundary values, i.e. an edge pass
+// after every sweep or the source kernel
+int bc_dynamic( const boundary_t* bc ) {
+    int e;
+
+    if ( bc->source ) return 1;
+    for ( e = 0; e < EDGE_COUNT; e++ )
+        if ( bc->edge[e].type == BC_NEUMANN ) return 1;
+    return 0;
+}
+
+const grid_t* bc_source( const boundary_t* bc ) {
+    return bc->source;
+}
+
+// Write the Dirichlet edges into g's boundary cells, left/right first so
+// top/bottom own the corners as they always have, then fill the Neumann ones.
+void bc_apply( const boundary_t* bc, grid_t* g ) {
+    const edge_t* e = bc->edge;
+    int rows = g->rows, columns = g->columns;
+    int i, j;
+
+    for ( i = 0; i <= rows+1; i++ ) {
+        if ( e[EDGE_LEFT].type == BC_DIRICHLET )  GRID(g,i,0)         = e[EDGE_LEFT].a  + e[EDGE_LEFT].b * i;
+        if ( e[EDGE_RIGHT].type == BC_DIRICHLET ) GRID(g,i,columns+1) = e[EDGE_RIGHT].a + e[EDGE_RIGHT].b * i;
+    }
+    for ( j = 0; j <= columns+1; j++ ) {
+        if ( e[EDGE_TOP].type == BC_DIRICHLET )    GRID(g,0,j)      = e[EDGE_TOP].a    + e[EDGE_TOP].b * j;
+        if ( e[EDGE_BOTTOM].type == BC_DIRICHLET ) GRID(g,rows+1,j) = e[EDGE_BOTTOM].a + e[EDGE_BOTTOM].b * j;
+    }
+    bc_edges( bc, g );
+}
+
+// Refresh the Neumann boundary cells of g from its interior, O(rows+columns).
+// Corners are never read by the 5 point stencil and are left alone.
+void bc_edges( const boundary_t* bc, grid_t* g ) {
+    const edge_t* e = bc->edge;
+    int rows = g->rows, columns = g->columns;
+    int i, j;
+
+    if ( e[EDGE_LEFT].type == BC_NEUMANN )
+        for ( i = 1; i <= rows; i++ ) GRID(g,i,0) = GRID(g,i,1) + e[EDGE_LEFT].a;
+    if ( e[EDGE_RIGHT].type == BC_NEUMANN )
+        for ( i = 1; i <= rows; i++ ) GRID(g,i,columns+1) = GRID(g,i,columns) + e[EDGE_RIGHT].a;
+    if ( e[EDGE_TOP].type == BC_NEUMANN )
+        for ( j = 1; j <= columns; j++ ) GRID(g,0,j) = GRID(g,1,j) + e[EDGE_TOP].a;
+    if ( e[EDGE_BOTTOM].type == BC_NEUMANN )
+        for ( j = 1; j <= columns; j++ ) GRID(g,rows+1,j) = GRID(g,rows,j) + e[EDGE_BOTTOM].a;
+}
+
+// jacobi_loop with the source term added to the neighbour sum
+double bc_source_loop( int row, int columns, int stride, double *restrict Temp,
+                       double *restrict Temp_last, const double *restrict source ) {
+    size_t off = (size_t)row * stride;
+    const double *restrict l = Temp_last + off;
+    const double *restrict f = source + off;
+    double *restrict t = Temp + off;
+    double m = 0.0;
+    int j;
+
+    #pragma omp simd reduction(max:m)
+    for ( j = 1; j <= columns; j++ ) {
+        t[j] = 0.25 * ( l[j-1] + l[j+1] + l[j-stride] + l[j+stride] + f[j] );
+        m = fmax( m, fabs( t[j] - l[j] ) );
+    }
+    return m;
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+#
+# Convergence check overhead of lap2-2 -m jacobi.
+# For each thread count, runs the same plate checking the largest change
+# every sweep and every 8/32/64 sweeps, and prints time per sweep so the
+# saved reduction + barrier cost shows up directly.
+#
+#   ./check_bench.sh [rows] [columns] [max_iterations]
+
+ROWS=${1:-4096}
+COLUMNS=${2:-${ROWS}}
+ITERS=${3:-1000}
+THREADS="1 8 32 64"
+INTERVALS="1 8 32 64"
+BIN=./lap2-2
+
+echo "threads, check_interval, iterations, seconds, usec_per_sweep"
+for T in ${THREADS}
+do
+    for C in ${INTERVALS}
+    do
+        # a tolerance of 1e-300 is never met, so every run does exactly ITERS sweeps
+        OUT=$(OMP_NUM_THREADS=${T} ${BIN} -r ${ROWS} -c ${COLUMNS} -n ${ITERS} -e 1e-300 -C ${C})
+        SECS=$(echo "${OUT}" | awk '/Total time was/ { print $4 }')
+        DONE=$(echo "${OUT}" | awk '/Max error at iteration/ { print $5 }')
+        echo "${T}, ${C}, ${DONE}, ${SECS}, $(awk -v s=${SECS} -v n=${DONE} 'BEGIN { printf "%.2f", 1e6*s/n }')"
+    done
+done
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "grid.h"
+
+// Checkpoints live in one memory-mapped file: a header page followed by two
+// grid sized slots.  A snapshot is copied into the slot that is not the
+// current valid one, and a background thread msyncs it and only then flips
+// the header to point at it, so a job killed at any moment leaves one whole
+// snapshot on disk.  The sweep only pays for the copy into the page cache.
+
+#define CKPT_MAGIC "LAPCKPT1"
+
+typedef struct {
+    char magic[8];
+    int  rows, columns, stride;
+    int  valid;              // slot holding the newest complete snapshot, -1 if none
+    int  iteration[2];       // sweeps completed when each slot was taken
+} ckpt_header_t;
+
+struct checkpoint {
+    int             fd;
+    char*           map;
+    size_t          map_bytes;
+    size_t          slot_bytes;
+    ckpt_header_t*  header;
+
+    pthread_t       writer;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             pending;     // slot handed to the writer, -1 if idle
+    int             pending_iteration;
+    int             quit;
+
+    int             written;
+    double          stall;       // seconds the solver spent between begin and commit
+    double          begun;
+    double          t0;
+};
+
+static double now( void ) {
+    struct timeval t;
+    gettimeofday( &t, NULL );
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static double* slot_data( checkpoint_t* ck, int slot ) {
+    return (double*)( ck->map + getpagesize() + slot * ck->slot_bytes );
+}
+
+static void* writer_main( void* arg ) {
+    checkpoint_t* ck = (checkpoint_t*)arg;
+
+    pthread_mutex_lock( &ck->lock );
+    for ( ;; ) {
+        while ( ck->pending < 0 && !ck->quit ) pthread_cond_wait( &ck->cond, &ck->lock );
+        if ( ck->pending < 0 ) break;
+
+        int slot = ck->pending;
+        int iteration = ck->pending_iteration;
+        pthread_mutex_unlock( &ck->lock );
+
+        // data first, then the header that makes it the valid snapshot
+        msync( slot_data( ck, slot ), ck->slot_bytes, MS_SYNC );
+        ck->header->iteration[slot] = iteration;
+        ck->header->valid = slot;
+        msync( ck->header, getpagesize(), MS_SYNC );
+
+        pthread_mutex_lock( &ck->lock );
+        ck->pending = -1;
+        ck->written++;
+        pthread_cond_broadcast( &ck->cond );
+    }
+    pthread_mutex_unlock( &ck->lock );
+    return NULL;
+}
+
+// Map the checkpoint file for grids shaped like g.  With create the file is
+// made (or resized) to fit and *kept says whether its header and slots were
+// already there in full; without, a file too short to hold them gives NULL.
+static checkpoint_t* ckpt_map( const char* path, const grid_t* g, int create, int* kept ) {
+    checkpoint_t* ck = (checkpoint_t*)calloc( 1, sizeof(checkpoint_t) );
+    size_t page = getpagesize();
+    struct stat st;
+
+    ck->slot_bytes = ( grid_bytes(g) + page - 1 ) / page * page;
+    ck->map_bytes  = page + 2 * ck->slot_bytes;
+
+    ck->fd = open( path, create ? O_RDWR | O_CREAT : O_RDWR, 0644 );
+    if ( ck->fd < 0 ) {
+        perror( path );
+        exit(1);
+    }
+    if ( fstat( ck->fd, &st ) != 0 ) {
+        perror( path );
+        exit(1);
+    }
+    if ( !create && (size_t)st.st_size < ck->map_bytes ) {
+        close( ck->fd );
+        free( ck );
+        return NULL;
+    }
+    if ( create ) {
+        *kept = (size_t)st.st_size >= ck->map_bytes;
+        if ( (size_t)st.st_size != ck->map_bytes && ftruncate( ck->fd, ck->map_bytes ) != 0 ) {
+            perror( path );
+            exit(1);
+        }
+    }
+
+    ck->map = (char*)mmap( NULL, ck->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ck->fd, 0 );
+    if ( ck->map == MAP_FAILED ) {
+        perror( path );
+        exit(1);
+    }
+    ck->header = (ckpt_header_t*)ck->map;
+    ck->pending = -1;
+    return ck;
+}
+
+static int header_matches( const ckpt_header_t* h, const grid_t* g ) {
+    return memcmp( h->magic, CKPT_MAGIC, sizeof(h->magic) ) == 0 && h->rows == g->rows &&
+           h->columns == g->columns && h->stride == g->stride;
+}
+
+// Open the checkpoint file for grids shaped like g and start the writer
+// thread.  A file that already holds a snapshot of this shape (the one a
+// restart just read) keeps it valid until the first new one is on disk;
+// anything else is started afresh.
+checkpoint_t* ckpt_open( const char* path, const grid_t* g ) {
+    int kept;
+    checkpoint_t* ck = ckpt_map( path, g, 1, &kept );
+    ckpt_header_t* h = ck->header;
+
+    if ( !kept || !header_matches( h, g ) || h->valid < -1 || h->valid > 1 ) {
+        memcpy( h->magic, CKPT_MAGIC, sizeof(h->magic) );
+        h->rows    = g->rows;
+        h->columns = g->columns;
+        h->stride  = g->stride;
+        h->valid   = -1;
+        msync( h, getpagesize(), MS_SYNC );
+    }
+
+    pthread_mutex_init( &ck->lock, NULL );
+    pthread_cond_init( &ck->cond, NULL );
+    pthread_create( &ck->writer, NULL, writer_main, ck );
+    ck->t0 = now();
+    return ck;
+}
+
+// Wait until the writer is idle and return the slot to copy the next
+// snapshot into: (rows+2) x stride doubles, laid out like the grid.
+double* ckpt_begin( checkpoint_t* ck ) {
+    ck->begun = now();
+
+    pthread_mutex_lock( &ck->lock );
+    while ( ck->pending >= 0 ) pthread_cond_wait( &ck->cond, &ck->lock );
+    pthread_mutex_unlock( &ck->lock );
+
+    return slot_data( ck, ck->header->valid == 0 ? 1 : 0 );
+}
+
+// hand the slot filled since ckpt_begin to the writer
+void ckpt_commit( checkpoint_t* ck, int iteration ) {
+    pthread_mutex_lock( &ck->lock );
+    ck->pending = ck->header->valid == 0 ? 1 : 0;
+    ck->pending_iteration = iteration;
+    pthread_cond_signal( &ck->cond );
+    pthread_mutex_unlock( &ck->lock );
+
+    ck->stall += now() - ck->begun;
+}
+
+// snapshot g after `iteration` sweeps, copying rows in parallel
+void ckpt_save( checkpoint_t* ck, const grid_t* g, int iteration ) {
+    double* slot = ckpt_begin( ck );
+    size_t row_bytes = (size_t)g->stride * sizeof(double);
+    int i;
+
+    #pragma omp parallel for schedule(static)
+    for ( i = 0; i <= g->rows + 1; i++ )
+        memcpy( slot + (size_t)i * g->stride, g->data + (size_t)i * g->stride, row_bytes );
+
+    ckpt_commit( ck, iteration );
+}
+
+// wait for the last snapshot to reach disk, report and release everything
+void ckpt_close( checkpoint_t* ck ) {
+    double run = now() - ck->t0;
+
+    pthread_mutex_lock( &ck->lock );
+    ck->quit = 1;
+    pthread_cond_signal( &ck->cond );
+    pthread_mutex_unlock( &ck->lock );
+    pthread_join( ck->writer, NULL );
+
+    printf( "Checkpoints: %d written, solver stalled %.3f s (%.2f%% of run)\n",
+            ck->written, ck->stall, run > 0 ? 100.0 * ck->stall / run : 0.0 );
+
+    munmap( ck->map, ck->map_bytes );
+    close( ck->fd );
+    pthread_mutex_destroy( &ck->lock );
+    pthread_cond_destroy( &ck->cond );
+    free( ck );
+}
+
+// Load the newest snapshot in path into g, which must have the same shape.
+// Returns the number of sweeps it had completed.
+int ckpt_restore( const char* path, grid_t* g ) {
+    checkpoint_t* ck = ckpt_map( path, g, 0, NULL );
+    ckpt_header_t* h = ck ? ck->header : NULL;
+    int i, iteration;
+
+    if ( ck == NULL || !header_matches( h, g ) || h->valid < 0 || h->valid > 1 ) {
+        fprintf( stderr, "%s: no usable %dx%d checkpoint\n", path, g->rows, g->columns );
+        exit(1);
+    }
+
+    const double* slot = slot_data( ck, h->valid );
+    for ( i = 0; i <= g->rows + 1; i++ )
+        memcpy( g->data + (size_t)i * g->stride, slot + (size_t)i * g->stride,
+                (size_t)g->stride * sizeof(double) );
+    iteration = h->iteration[h->valid];
+
+    munmap( ck->map, ck->map_bytes );
+    close( ck->fd );
+    free( ck );
+    return iteration;
+}
@@ -1,7 +1,38 @@
-// size of plate
+// default size of plate (override at run time with -r/-c)
 #define COLUMNS    1000
 #define ROWS       1000
 
 // largest permitted change in temp (This value takes about 3400 steps)
+// override at run time with -e
 #define MAX_TEMP_ERROR 0.01
 
+// temporal blocking defaults (override with -k and -b); -m tb only gains
+// once the two grids no longer fit in the last level cache
+#define TB_SWEEPS     8
+#define TILE_ROWS     64
+#define TILE_COLS     256
+
+// sweeps -m tiled times each candidate tile shape for
+#define TUNE_SWEEPS   2
+
+// -m active: sweeps a tile must stay below tolerance, together with its
+// neighbours, before it is skipped, and how often every tile is recomputed
+#define ACTIVE_QUIET       4
+#define ACTIVE_REVALIDATE  100
+
+// multigrid V-cycle shape
+#define MG_PRE_SWEEPS     2
+#define MG_POST_SWEEPS    2
+#define MG_COARSE_SWEEPS  50
+#define MG_COARSEST       4     // stop coarsening below this many cells per side
+#define MG_JACOBI_WEIGHT  0.8   // damping for the jacobi smoother
+
+// sweeps timed by numa-bench for each first touch policy
+#define BENCH_SWEEPS      20
+
+// grids are allocated on this boundary and rows are padded to a multiple of it
+#define GRID_ALIGN 64
+
+
+// snapshot file for -x/-R (override with -X)
+#define CHECKPOINT_FILE "laplace.ckpt"
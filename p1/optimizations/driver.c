@@ -26,15 +26,17 @@
 #include <sys/time.h>
 
 #include "config.h"
+#include "grid.h"
 
-double Temperature[ROWS+2][COLUMNS+2];      // temperature grid
-double Temperature_last[ROWS+2][COLUMNS+2]; // temperature grid from last iteration
+grid_t* Temperature;      // temperature grid
+grid_t* Temperature_last; // temperature grid from last iteration
 
 //   helper routines
-void initialize();
+void initialize( int rows, int columns );
 void track_progress(int iter, double dt);
 
-float jacobi_loop( int row, double* Temp, double* Temp_last );
+double jacobi_loop( int row, int columns, int stride, double* Temp, double* Temp_last );
+const char* jacobi_kernel( void );
 
 int main(int argc, char *argv[]) {
 
@@ -43,33 +45,43 @@ int main(int argc, char *argv[]) {
     int iteration=1;                                     // current iteration
     double dt=100;                                       // largest change in t
     struct timeval start_time, stop_time, elapsed_time;  // timers
+    params_t params;                                     // plate size and tolerance
 
-    printf("Maximum iterations [100-4000]?\n");
-    scanf("%d", &max_iterations);
+    parse_params( argc, argv, &params );
+    int rows    = params.rows;
+    int columns = params.columns;
 
-    initialize();                   // initialize Temp_last including boundary conditions
+    max_iterations = params.max_iterations;
+    if ( max_iterations == 0 ) {
+        printf("Maximum iterations [100-4000]?\n");
+        scanf("%d", &max_iterations);
+    }
+
+    initialize( rows, columns );    // initialize Temp_last including boundary conditions
+    jacobi_kernel();                // pick the row kernel before any thread needs it
     gettimeofday(&start_time,NULL); // Unix timer
 
-    double* Temp = (double*)Temperature;
-    double* Temp_last = (double*)Temperature_last;
+    int stride = Temperature->stride;
+    double* Temp = Temperature->data;
+    double* Temp_last = Temperature_last->data;
 
     // do until error is minimal or until max steps
-    while ( dt > MAX_TEMP_ERROR && iteration <= max_iterations ) {
+    while ( dt > params.max_temp_error && iteration <= max_iterations ) {
 
         dt = 0.0; // reset largest temperature change
         // main calculation: average my four neighbors
         #pragma omp parallel for
-        for(i = 1; i <= ROWS; i++) {
-            jacobi_loop( i, Temp, Temp_last );
+        for(i = 1; i <= rows; i++) {
+            jacobi_loop( i, columns, stride, Temp, Temp_last );
         }
         
 
         // copy grid to old grid for next iteration and find latest dt
         #pragma omp parallel for private(j) reduction(max:dt)
-        for(i = 1; i <= ROWS; i++){
-            for(j = 1; j <= COLUMNS; j++){
-	      dt = fmax( fabs(Temperature[i][j]-Temperature_last[i][j]), dt);
-	      Temperature_last[i][j] = Temperature[i][j];
+        for(i = 1; i <= rows; i++){
+            for(j = 1; j <= columns; j++){
+	      dt = fmax( fabs(GRID(Temperature,i,j)-GRID(Temperature_last,i,j)), dt);
+	      GRID(Temperature_last,i,j) = GRID(Temperature,i,j);
             }
         }
 
@@ -87,33 +99,32 @@ int main(int argc, char *argv[]) {
     printf("\nMax error at iteration %d was %f\n", iteration-1, dt);
     printf("Total time was %f seconds.\n", elapsed_time.tv_sec+elapsed_time.tv_usec/1000000.0);
 
+    grid_free( Temperature );
+    grid_free( Temperature_last );
 }
 
 
 // initialize plate and boundary conditions
 // Temp_last is used to to start first iteration
-void initialize(){
+void initialize( int rows, int columns ){
 
     int i,j;
 
-    for(i = 0; i <= ROWS+1; i++){
-        for (j = 0; j <= COLUMNS+1; j++){
-            Temperature_last[i][j] = 0.0;
-        }
-    }
+    Temperature      = grid_alloc( rows, columns );   // zero filled
+    Temperature_last = grid_alloc( rows, columns );
 
     // these boundary conditions never change throughout run
 
     // set left side to 0 and right to a linear increase
-    for(i = 0; i <= ROWS+1; i++) {
-        Temperature_last[i][0] = 0.0;
-        Temperature_last[i][COLUMNS+1] = (100.0/ROWS)*i;
+    for(i = 0; i <= rows+1; i++) {
+        GRID(Temperature_last,i,0) = 0.0;
+        GRID(Temperature_last,i,columns+1) = (100.0/rows)*i;
     }
     
     // set top to 0 and bottom to linear increase
-    for(j = 0; j <= COLUMNS+1; j++) {
-        Temperature_last[0][j] = 0.0;
-        Temperature_last[ROWS+1][j] = (100.0/COLUMNS)*j;
+    for(j = 0; j <= columns+1; j++) {
+        GRID(Temperature_last,0,j) = 0.0;
+        GRID(Temperature_last,rows+1,j) = (100.0/columns)*j;
     }
 }
 
@@ -122,11 +133,15 @@ void initialize(){
 void track_progress(int iteration, double dt) {
 
     int i;
+    int rows = Temperature->rows;
+    int columns = Temperature->columns;
+    int diag = rows < columns ? rows : columns;
 
     printf("---------- Iteration number: %d ------------\n", iteration);
-    printf( "[%d,%d]: %5.2f  ", 250, 900, Temperature[250][900] );
-    for(i = ROWS-5; i <= ROWS; i++) {
-        printf("[%d,%d]: %5.2f  ", i, i, Temperature[i][i]);
+    if ( rows >= 250 && columns >= 900 )
+        printf( "[%d,%d]: %5.2f  ", 250, 900, GRID(Temperature,250,900) );
+    for(i = diag-5 > 1 ? diag-5 : 1; i <= diag; i++) {
+        printf("[%d,%d]: %5.2f  ", i, i, GRID(Temperature,i,i));
     }
     printf( "  max error=%7.4f  ", dt );
     printf("\n");
@@ -27,103 +27,370 @@
 #include <sys/time.h>
 
 #include "config.h"
+#include "grid.h"
 
-double Temperature[ROWS+2][COLUMNS+2];      // temperature grid
-double Temperature_last[ROWS+2][COLUMNS+2]; // temperature grid from last iteration
+grid_t* Temperature;      // temperature grid
+grid_t* Temperature_last; // temperature grid from last iteration
+boundary_t* Boundary;     // edge conditions and heat sources
 
 //   helper routines
-void initialize();
-void track_progress(int iter, double dt, double*, double* );
+void initialize( int rows, int columns, int in_place );
+void track_progress(int iter, double dt, const grid_t* );
 
-double jacobi_loop( int row, double *restrict Temp, double *restrict Temp_last );
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+const char* jacobi_kernel( void );
 
 int main(int argc, char *argv[]) {
 
-    int i, j;                                            // grid indexes
+    int i;                                               // grid indexes
     int max_iterations;                                  // number of iterations
     int iteration=1;                                     // current iteration
     double dt=100;                                       // largest change in t
     struct timeval start_time, stop_time, elapsed_time;  // timers
+    params_t params;                                     // plate size and tolerance
 
-    printf("Maximum iterations [100-4000]?\n");
-    scanf("%d", &max_iterations);
+    parse_params( argc, argv, &params );
+    int rows    = params.rows;
+    int columns = params.columns;
 
-    initialize();                   // initialize Temp_last including boundary conditions
+    max_iterations = params.max_iterations;
+    if ( max_iterations == 0 ) {
+        printf("Maximum iterations [100-4000]?\n");
+        scanf("%d", &max_iterations);
+    }
+
+    // Gauss-Seidel, SOR and multigrid update one grid in place, there is no Temperature_last;
+    // the float and mixed solvers keep their own working copies
+    int precision = ( params.mode == MODE_FLOAT || params.mode == MODE_MIXED );
+    int in_place = ( params.mode == MODE_RBGS || params.mode == MODE_SOR || params.mode == MODE_MG
+                     || precision );
+    size_t working_set = 0;
+    double omega = 1.0;
+    if ( params.mode == MODE_SOR )
+        omega = params.omega > 0.0 ? params.omega : sor_optimal_omega( rows, columns );
+
+    Boundary = params.boundary_file ? bc_load( params.boundary_file, rows, columns )
+                                    : bc_default( rows, columns );
+    // Neumann edges and sources need work between sweeps, which only the
+    // plain jacobi loop does; fixed edges are just initial values
+    if ( bc_dynamic( Boundary ) && params.mode != MODE_JACOBI ) {
+        fprintf(stderr, "Neumann edges and heat sources need -m jacobi\n");
+        exit(1);
+    }
+    const grid_t* source = bc_source( Boundary );
+
+    pin_threads( params.pin );      // before the grids are first touched
+    jacobi_kernel();                // pick the row kernel before any thread needs it
+    initialize( rows, columns, in_place ); // initialize Temp_last including boundary conditions
+
+    // the multigrid and precision solvers keep state a single grid does not capture
+    checkpoint_t* ck = NULL;
+    if ( params.checkpoint_interval > 0 || params.restart ) {
+        if ( params.mode == MODE_MG || precision ) {
+            fprintf(stderr, "checkpointing supports -m jacobi, tb, tiled, active, rbgs and sor only\n");
+            exit(1);
+        }
+        // the jacobi modes only carry the latest sweep forward, the other
+        // grid is rewritten in full before it is read
+        if ( params.restart ) {
+            iteration = ckpt_restore( params.checkpoint_file,
+                                      in_place ? Temperature : Temperature_last ) + 1;
+            printf("Restarted from %s after iteration %d\n", params.checkpoint_file, iteration-1);
+        }
+        if ( params.checkpoint_interval > 0 )
+            ck = ckpt_open( params.checkpoint_file, Temperature );
+    }
+
+    multigrid_t* mg = NULL;
+    if ( params.mode == MODE_MG ) mg = mg_create( Temperature, params.smoother );
+
+    active_t* active = NULL;
+    int verify = 0;     // -m active: a partial sweep met the tolerance, confirm with a full one
+    if ( params.mode == MODE_ACTIVE )
+        active = active_create( rows, columns, params.tile_rows, params.tile_cols,
+                                params.max_temp_error );
+
+    tiler_t* tiler = NULL;
+    if ( params.mode == MODE_TILED )
+        tiler = params.autotune ? tiler_create( rows, columns, 0, 0 )
+                                : tiler_create( rows, columns, params.tile_rows, params.tile_cols );
+
+    int first_iteration = iteration;  // rates only count sweeps done in this run
     gettimeofday(&start_time,NULL); // Unix timer
 
-    double* Temp = (double*)Temperature;
-    double* Temp_last = (double*)Temperature_last;
+    int stride = Temperature->stride;
+    grid_t* T = Temperature;
+    grid_t* T_last = Temperature_last;
 
     // do until error is minimal or until max steps
-    while ( dt > MAX_TEMP_ERROR && iteration <= max_iterations ) {
+    while ( (dt > params.max_temp_error || verify) && iteration <= max_iterations ) {
 
-        dt = 0.0; // reset largest temperature change
-        // main calculation: average my four neighbors
-        #pragma omp parallel for reduction(max:dt)
-        for(i = 1; i <= ROWS; i++) {
-            dt = fmax( dt, jacobi_loop( i, Temp, Temp_last ) );
+        if ( precision ) {
+            int sweeps;
+            dt = precision_solve( T, params.mode, max_iterations, params.max_temp_error,
+                                  &sweeps, &working_set );
+            iteration += sweeps;
+            track_progress(iteration-1, dt, T);
+            break;
+        }
+
+        if ( params.mode == MODE_MG ) {
+            // one V-cycle per iteration
+            dt = mg_vcycle( mg );
+            track_progress(iteration, dt, T);
+            iteration++;
+            continue;
         }
-        
-        double* tmp = Temp;
-        Temp = Temp_last;
-        Temp_last = tmp;
-
-        // periodically print test values
-        if((iteration % 100) == 0) {
- 	    track_progress(iteration, dt, Temp, Temp_last);
+
+        if ( in_place ) {
+            dt = redblack_sweep( T, omega );
+
+            if((iteration % 100) == 0) {
+                track_progress(iteration, dt, T);
+            }
+
+            if ( ck && iteration % params.checkpoint_interval == 0 )
+                ckpt_save( ck, T, iteration );
+
+            iteration++;
+            continue;
+        }
+
+        if ( params.mode == MODE_TB ) {
+            // several sweeps per cache resident tile, convergence checked once per pass
+            int sweeps = max_iterations - iteration + 1;
+            if ( sweeps > params.sweeps ) sweeps = params.sweeps;
+
+            dt = jacobi_tb( T, T_last, sweeps, params.tile_rows, params.tile_cols );
+
+            grid_t* tmp = T;
+            T = T_last;
+            T_last = tmp;
+
+            if ( (iteration-1)/100 != (iteration+sweeps-1)/100 ) {
+                track_progress(iteration+sweeps-1, dt, T_last);
+            }
+
+            if ( ck && (iteration-1)/params.checkpoint_interval
+                       != (iteration+sweeps-1)/params.checkpoint_interval )
+                ckpt_save( ck, T_last, iteration+sweeps-1 );
+
+            iteration += sweeps;
+            continue;
+        }
+
+        if ( params.mode == MODE_ACTIVE ) {
+            // skipped tiles make a partial sweep's change a lower bound, so only
+            // a full sweep may end the run
+            int full = ( verify || iteration % ACTIVE_REVALIDATE == 0 || iteration == max_iterations );
+            dt = active_sweep( active, T, T_last, full );
+            verify = ( !full && dt <= params.max_temp_error );
+
+            grid_t* tmp = T;
+            T = T_last;
+            T_last = tmp;
+
+            if((iteration % 100) == 0) {
+                track_progress(iteration, dt, T_last);
+            }
+
+            if ( ck && iteration % params.checkpoint_interval == 0 )
+                ckpt_save( ck, T_last, iteration );
+
+            iteration++;
+            continue;
         }
 
-	iteration++;
+        if ( params.mode == MODE_TILED ) {
+            dt = tiler_sweep( tiler, T, T_last );
+
+            grid_t* tmp = T;
+            T = T_last;
+            T_last = tmp;
+
+            if((iteration % 100) == 0) {
+                track_progress(iteration, dt, T_last);
+            }
+
+            if ( ck && iteration % params.checkpoint_interval == 0 )
+                ckpt_save( ck, T_last, iteration );
+
+            iteration++;
+            continue;
+        }
+
+        // plain jacobi: one parallel region for the whole run, with the
+        // largest change only reduced on every check_interval'th sweep
+        int done = 0;
+        int save = 0;
+        double* slot = NULL;
+        dt = 0.0; // reset largest temperature change
+        #pragma omp parallel private(i)
+        while ( !done ) {
+            int check = ( iteration % params.check_interval == 0 || iteration == max_iterations );
+            double* Temp = T->data;
+            double* Temp_last = T_last->data;
+
+            // main calculation: average my four neighbors
+            if ( source ) {
+                #pragma omp for schedule(static) reduction(max:dt)
+                for(i = 1; i <= rows; i++) {
+                    dt = fmax( dt, bc_source_loop( i, columns, stride, Temp, Temp_last, source->data ) );
+                }
+            }
+            else if ( check ) {
+                #pragma omp for schedule(static) reduction(max:dt)
+                for(i = 1; i <= rows; i++) {
+                    dt = fmax( dt, jacobi_loop( i, columns, stride, Temp, Temp_last ) );
+                }
+            }
+            else {
+                #pragma omp for schedule(static)
+                for(i = 1; i <= rows; i++) {
+                    jacobi_loop( i, columns, stride, Temp, Temp_last );
+                }
+            }
+
+            #pragma omp single
+            {
+                grid_t* tmp = T;
+                T = T_last;
+                T_last = tmp;
+
+                // edge pass: Neumann boundary cells follow the new interior
+                bc_edges( Boundary, T_last );
+
+                // periodically print test values
+                if ( check && (iteration % 100) == 0 ) {
+                    track_progress(iteration, dt, T_last);
+                }
+
+                if ( (check && dt <= params.max_temp_error) || iteration == max_iterations )
+                    done = 1;
+                else if ( (iteration+1) % params.check_interval == 0 || iteration+1 == max_iterations )
+                    dt = 0.0; // reset largest temperature change before the next check
+
+                save = ( ck && iteration % params.checkpoint_interval == 0 );
+                if ( save ) slot = ckpt_begin( ck );
+
+                iteration++;
+            }
+
+            // snapshot the sweep just finished, every thread copying its own rows
+            if ( save ) {
+                #pragma omp for schedule(static)
+                for(i = 0; i <= rows+1; i++) {
+                    memcpy( slot + (size_t)i*stride, T_last->data + (size_t)i*stride,
+                            stride * sizeof(double) );
+                }
+
+                #pragma omp single
+                ckpt_commit( ck, iteration-1 );
+            }
+        }
     }
 
     gettimeofday(&stop_time,NULL);
     timersub(&stop_time, &start_time, &elapsed_time); // Unix time subtract routine
 
+    double seconds = elapsed_time.tv_sec+elapsed_time.tv_usec/1000000.0;
+    double cells   = (double)rows * columns * (iteration-first_iteration);
+    if ( active ) cells *= active_work( active );   // count only the tiles actually swept
+
     printf("\nMax error at iteration %d was %f\n", iteration-1, dt);
-    printf("Total time was %f seconds.\n", elapsed_time.tv_sec+elapsed_time.tv_usec/1000000.0);
+    printf("Total time was %f seconds.\n", seconds);
+
+    // 5 flops per cell update; a streaming sweep reads T_last and writes T once
+    printf("Solver %s", mode_name(params.mode));
+    if ( params.mode == MODE_JACOBI )
+        printf(" (%s row kernel, check every %d)", jacobi_kernel(), params.check_interval);
+    if ( params.mode == MODE_TB )
+        printf(" (%d sweeps/pass, %dx%d tiles)", params.sweeps, params.tile_rows, params.tile_cols);
+    if ( tiler )
+        tiler_report( tiler );
+    if ( active )
+        active_report( active );
+    if ( params.mode == MODE_SOR )
+        printf(" (omega %.4f)", omega);
+    if ( params.mode == MODE_MG )
+        printf(" (%d levels, %s smoother)", mg_levels(mg), smoother_name(params.smoother));
+    printf(", %d %s to converge, grid memory %.1f MB\n", iteration-1,
+           params.mode == MODE_MG ? "V-cycles" : "iterations",
+           ( grid_bytes(Temperature) + (in_place ? 0 : grid_bytes(Temperature_last))
+             + (mg ? mg_bytes(mg) : 0) ) / 1.0e6);
+
+    // a V-cycle is not one sweep, so the per-sweep rates only apply to the other modes
+    if ( params.mode != MODE_MG ) {
+        printf("Performance = %5.2f Gflops, %.3e cells/s\n", 5.0 * cells / seconds / 1.0e9, cells / seconds);
+        int bytes_per_cell = precision ? 2*sizeof(float) : 2*sizeof(double);
+        printf("Bandwidth = %5.2f GB/s (sweep-equivalent, %d bytes/cell)\n",
+               bytes_per_cell * cells / seconds / 1.0e9, bytes_per_cell);
+    }
+
+    if ( mg ) mg_destroy( mg );
+    if ( tiler ) tiler_destroy( tiler );
+    if ( active ) active_destroy( active );
+    if ( ck ) ckpt_close( ck );
+
+    // compare against the same solve done entirely in double
+    if ( precision ) {
+        grid_t* reference_last = Temperature_last;
+        grid_t* result = Temperature;
+        int ref_iterations;
+        size_t ref_bytes;
+
+        initialize( rows, columns, 1 );
+        gettimeofday(&start_time,NULL);
+        precision_solve( Temperature, MODE_JACOBI, max_iterations, params.max_temp_error,
+                         &ref_iterations, &ref_bytes );
+        gettimeofday(&stop_time,NULL);
+        timersub(&stop_time, &start_time, &elapsed_time);
 
+        printf("Precision %s: sweep working set %.1f MB, %.3f s to tolerance\n",
+               mode_name(params.mode), working_set / 1.0e6, seconds);
+        printf("Precision double (-m jacobi sweep): working set %.1f MB, %.3f s to tolerance (%d iterations)\n",
+               ref_bytes / 1.0e6, elapsed_time.tv_sec+elapsed_time.tv_usec/1000000.0, ref_iterations);
+        printf("Max difference from double run = %e\n", max_difference( result, Temperature ));
+
+        grid_free( result );
+        grid_free( reference_last );
+    }
+
+    grid_free( Temperature );
+    grid_free( Temperature_last );
+    bc_free( Boundary );
 }
 
 
 // initialize plate and boundary conditions
 // Temp_last is used to to start first iteration
-void initialize(){
-
-    int i,j;
+// in place solvers only get Temperature; Temperature_last stays NULL
+void initialize( int rows, int columns, int in_place ){
 
-    memset( Temperature_last, 0, sizeof(Temperature_last) );
-    memset( Temperature, 0, sizeof(Temperature) );
-    for(i = 0; i <= ROWS+1; i++){
-        for (j = 0; j <= COLUMNS+1; j++){
-            Temperature_last[i][j] = 0.0;
-        }
-    }
+    Temperature      = grid_alloc( rows, columns );   // zero filled
+    Temperature_last = in_place ? Temperature : grid_alloc( rows, columns );
 
-    // these boundary conditions never change throughout run
+    // fixed edges never change throughout run, see bc.c
+    bc_apply( Boundary, Temperature );
+    bc_apply( Boundary, Temperature_last );
 
-    // set left side to 0 and right to a linear increase
-    for(i = 0; i <= ROWS+1; i++) {
-        Temperature_last[i][0] = 0.0;
-        Temperature[i][COLUMNS+1] = Temperature_last[i][COLUMNS+1] = (100.0/ROWS)*i;
-    }
-    
-    // set top to 0 and bottom to linear increase
-    for(j = 0; j <= COLUMNS+1; j++) {
-        Temperature_last[0][j] = 0.0;
-        Temperature[ROWS+1][j] = Temperature_last[ROWS+1][j] = (100.0/COLUMNS)*j;
-    }
+    if ( in_place ) Temperature_last = NULL;
 }
 
 
 // print diagonal in bottom right corner where most action is
-void track_progress(int iteration, double dt, double *restrict Temperature, double *restrict Temperature_last) {
+void track_progress(int iteration, double dt, const grid_t* Temperature) {
 
     int i;
+    int rows = Temperature->rows;
+    int columns = Temperature->columns;
+    int diag = rows < columns ? rows : columns;
 
     printf("---------- Iteration number: %d ------------\n", iteration);
-    printf( "[%d,%d]: %5.2f  ", 250, 900, Temperature[250*(COLUMNS+2)+900] );
-    for(i = ROWS-5; i <= ROWS; i++) {
-        printf("[%d,%d]: %5.2f  ", i, i, Temperature[i*(COLUMNS+2)+i]);
+    if ( rows >= 250 && columns >= 900 )
+        printf( "[%d,%d]: %5.2f  ", 250, 900, GRID(Temperature,250,900) );
+    for(i = diag-5 > 1 ? diag-5 : 1; i <= diag; i++) {
+        printf("[%d,%d]: %5.2f  ", i, i, GRID(Temperature,i,i));
     }
     printf( "  max error=%7.4f  ", dt );
     printf("\n");
@@ -0,0 +1,287 @@
+/*************************************************
+ * Laplace MPI C Version
+ *
+ * Same plate, boundaries and output as driver2.c, with the
+ * plate split over a 2D Cartesian grid of MPI ranks.  Each
+ * rank holds its block plus a one cell halo; halos travel
+ * with MPI_Isend/MPI_Irecv while the block interior is
+ * updated, and the global largest change is one
+ * MPI_Allreduce(MAX) per check (-C sweeps apart).
+ * With -A the check is an MPI_Iallreduce that is
+ * only waited for after the following sweep.
+ *
+ *   mpirun -np 4 ./lap-mpi -r 2000 -c 2000
+ *
+ ************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "config.h"
+#include "grid.h"
+
+#define BLOCK_LOW(id,p,n)  ((id)*(n)/(p))
+#define BLOCK_SIZE(id,p,n) (BLOCK_LOW((id)+1,p,n)-BLOCK_LOW(id,p,n))
+
+// this rank's piece of the plate
+typedef struct {
+    MPI_Comm comm;          // 2D Cartesian communicator
+    int rank;
+    int dims[2], coords[2];
+    int up, down, left, right;
+    int row0, col0;         // global index of local cell (0,0), the halo corner
+    int rows, columns;      // global plate size
+    MPI_Datatype column;    // one halo column of a local grid
+} domain_t;
+
+grid_t* Temperature;      // temperature grid (local block)
+grid_t* Temperature_last; // temperature grid from last iteration (local block)
+
+//   helper routines
+void initialize( domain_t* d );
+void track_progress( int iter, double dt, const domain_t* d, const grid_t* T );
+void exchange_halos( const domain_t* d, grid_t* T, MPI_Request req[8] );
+double update_edges( grid_t* T, const grid_t* T_last );
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+const char* jacobi_kernel( void );
+
+int main(int argc, char *argv[]) {
+
+    int i;                                               // grid indexes
+    int max_iterations;                                  // number of iterations
+    int iteration=1;                                     // current iteration
+    double dt=100;                                       // largest change in t
+    double start_time, elapsed_time;                     // timers
+    params_t params;                                     // plate size and tolerance
+    domain_t d;
+    int p, periods[2] = { 0, 0 };
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    parse_params( argc, argv, &params );
+    d.rows    = params.rows;
+    d.columns = params.columns;
+
+    d.dims[0] = d.dims[1] = 0;
+    MPI_Dims_create( p, 2, d.dims );
+    MPI_Cart_create( MPI_COMM_WORLD, 2, d.dims, periods, 1, &d.comm );
+    MPI_Comm_rank( d.comm, &d.rank );
+    MPI_Cart_coords( d.comm, d.rank, 2, d.coords );
+    MPI_Cart_shift( d.comm, 0, 1, &d.up, &d.down );
+    MPI_Cart_shift( d.comm, 1, 1, &d.left, &d.right );
+
+    if ( d.rows < d.dims[0] || d.columns < d.dims[1] ) {
+        if ( !d.rank ) fprintf( stderr, "plate %dx%d too small for %dx%d ranks\n",
+                                d.rows, d.columns, d.dims[0], d.dims[1] );
+        MPI_Abort( MPI_COMM_WORLD, 1 );
+    }
+
+    max_iterations = params.max_iterations;
+    if ( !d.rank && max_iterations == 0 ) {
+        printf("Maximum iterations [100-4000]?\n");
+        fflush(stdout);
+        if ( scanf("%d", &max_iterations) != 1 ) max_iterations = 0;
+    }
+    MPI_Bcast( &max_iterations, 1, MPI_INT, 0, MPI_COMM_WORLD );
+
+    initialize( &d );               // initialize Temp_last including boundary conditions
+    jacobi_kernel();                // pick the row kernel before any thread needs it
+
+    int rows    = Temperature->rows;
+    int columns = Temperature->columns;
+    int stride  = Temperature->stride;
+    grid_t* T = Temperature;
+    grid_t* T_last = Temperature_last;
+    MPI_Request req[8];
+
+    MPI_Barrier( d.comm );
+    start_time = MPI_Wtime();
+
+    // convergence check still in flight with -A
+    MPI_Request check_req = MPI_REQUEST_NULL;
+    double send_dt, recv_dt;
+    int done = 0;
+
+    // do until error is minimal or until max steps
+    while ( !done && iteration <= max_iterations ) {
+
+        double* Temp = T->data;
+        double* Temp_last = T_last->data;
+        double local_dt = 0.0;
+        int check = ( iteration % params.check_interval == 0 || iteration == max_iterations );
+
+        // start the halo swap, then do every cell that does not need it
+        exchange_halos( &d, T_last, req );
+
+        #pragma omp parallel for reduction(max:local_dt)
+        for(i = 2; i <= rows-1; i++) {
+            if ( columns > 2 )
+                local_dt = fmax( local_dt, jacobi_loop( i, columns-2, stride, Temp+1, Temp_last+1 ) );
+        }
+
+        MPI_Waitall( 8, req, MPI_STATUSES_IGNORE );
+        local_dt = fmax( local_dt, update_edges( T, T_last ) );
+
+        grid_t* tmp = T;
+        T = T_last;
+        T_last = tmp;
+
+        // a lagged check posted last sweep has had this whole sweep to finish
+        if ( check_req != MPI_REQUEST_NULL ) {
+            MPI_Wait( &check_req, MPI_STATUS_IGNORE );
+            dt = recv_dt;
+            if ( dt <= params.max_temp_error ) done = 1;
+        }
+
+        if ( check && !done ) {
+            send_dt = local_dt;
+            if ( params.async_check && iteration < max_iterations ) {
+                MPI_Iallreduce( &send_dt, &recv_dt, 1, MPI_DOUBLE, MPI_MAX, d.comm, &check_req );
+            }
+            else {
+                MPI_Allreduce( &send_dt, &dt, 1, MPI_DOUBLE, MPI_MAX, d.comm );
+                if ( dt <= params.max_temp_error ) done = 1;
+            }
+        }
+
+        // periodically print test values
+        if((iteration % 100) == 0) {
+            track_progress(iteration, dt, &d, T_last);
+        }
+
+        iteration++;
+    }
+
+    elapsed_time = MPI_Wtime() - start_time;
+
+    if ( !d.rank ) {
+        double cells = (double)d.rows * d.columns * (iteration-1);
+
+        printf("\nMax error at iteration %d was %f\n", iteration-1, dt);
+        printf("Total time was %f seconds.\n", elapsed_time);
+        printf("Solver mpi (%dx%d ranks, check every %d%s), %d iterations to converge\n",
+               d.dims[0], d.dims[1], params.check_interval,
+               params.async_check ? " lagged" : "", iteration-1);
+        printf("Performance = %5.2f Gflops, %.3e cells/s\n",
+               5.0 * cells / elapsed_time / 1.0e9, cells / elapsed_time);
+    }
+
+    MPI_Type_free( &d.column );
+    grid_free( Temperature );
+    grid_free( Temperature_last );
+    MPI_Comm_free( &d.comm );
+    MPI_Finalize();
+    return 0;
+}
+
+
+// Post the eight non-blocking transfers that refresh T's halo ring.
+// MPI_PROC_NULL neighbours (the plate edge) complete immediately.
+void exchange_halos( const domain_t* d, grid_t* T, MPI_Request req[8] ) {
+    int rows = T->rows, columns = T->columns;
+
+    MPI_Irecv( &GRID(T,0,1),         columns, MPI_DOUBLE, d->up,    0, d->comm, &req[0] );
+    MPI_Irecv( &GRID(T,rows+1,1),    columns, MPI_DOUBLE, d->down,  1, d->comm, &req[1] );
+    MPI_Irecv( &GRID(T,1,0),         1,       d->column,  d->left,  2, d->comm, &req[2] );
+    MPI_Irecv( &GRID(T,1,columns+1), 1,       d->column,  d->right, 3, d->comm, &req[3] );
+
+    MPI_Isend( &GRID(T,1,1),         columns, MPI_DOUBLE, d->up,    1, d->comm, &req[4] );
+    MPI_Isend( &GRID(T,rows,1),      columns, MPI_DOUBLE, d->down,  0, d->comm, &req[5] );
+    MPI_Isend( &GRID(T,1,1),         1,       d->column,  d->left,  3, d->comm, &req[6] );
+    MPI_Isend( &GRID(T,1,columns),   1,       d->column,  d->right, 2, d->comm, &req[7] );
+}
+
+
+// update the outermost ring of the block once the halo has arrived
+double update_edges( grid_t* T, const grid_t* T_last ) {
+    int rows = T->rows, columns = T->columns, stride = T->stride;
+    double dt = 0.0;
+    int i;
+
+    dt = fmax( dt, jacobi_loop( 1, columns, stride, T->data, T_last->data ) );
+    if ( rows > 1 )
+        dt = fmax( dt, jacobi_loop( rows, columns, stride, T->data, T_last->data ) );
+
+    for ( i = 2; i <= rows-1; i++ ) {
+        dt = fmax( dt, jacobi_loop( i, 1, stride, T->data, T_last->data ) );
+        if ( columns > 1 )
+            dt = fmax( dt, jacobi_loop( i, 1, stride, T->data + columns-1, T_last->data + columns-1 ) );
+    }
+    return dt;
+}
+
+
+// initialize plate and boundary conditions for this rank's block
+// Temp_last is used to to start first iteration
+void initialize( domain_t* d ){
+
+    int i,j;
+    int rows    = BLOCK_SIZE( d->coords[0], d->dims[0], d->rows );
+    int columns = BLOCK_SIZE( d->coords[1], d->dims[1], d->columns );
+
+    d->row0 = BLOCK_LOW( d->coords[0], d->dims[0], d->rows );
+    d->col0 = BLOCK_LOW( d->coords[1], d->dims[1], d->columns );
+
+    Temperature      = grid_alloc( rows, columns );   // zero filled
+    Temperature_last = grid_alloc( rows, columns );
+
+    MPI_Type_vector( rows, 1, Temperature->stride, MPI_DOUBLE, &d->column );
+    MPI_Type_commit( &d->column );
+
+    // these boundary conditions never change throughout run
+
+    // set left side to 0 and right to a linear increase
+    for(i = 0; i <= rows+1; i++) {
+        int gi = d->row0 + i;
+        if ( d->left == MPI_PROC_NULL )
+            GRID(Temperature,i,0) = GRID(Temperature_last,i,0) = 0.0;
+        if ( d->right == MPI_PROC_NULL )
+            GRID(Temperature,i,columns+1) = GRID(Temperature_last,i,columns+1) = (100.0/d->rows)*gi;
+    }
+
+    // set top to 0 and bottom to linear increase
+    for(j = 0; j <= columns+1; j++) {
+        int gj = d->col0 + j;
+        if ( d->up == MPI_PROC_NULL )
+            GRID(Temperature,0,j) = GRID(Temperature_last,0,j) = 0.0;
+        if ( d->down == MPI_PROC_NULL )
+            GRID(Temperature,rows+1,j) = GRID(Temperature_last,rows+1,j) = (100.0/d->columns)*gj;
+    }
+}
+
+
+// print diagonal in bottom right corner where most action is;
+// each rank contributes the points it owns and rank 0 prints them
+void track_progress( int iteration, double dt, const domain_t* d, const grid_t* T ) {
+
+    int i, n = 0;
+    int diag = d->rows < d->columns ? d->rows : d->columns;
+    int gi[7], gj[7];
+    double mine[7] = { 0 }, all[7];
+
+    if ( d->rows >= 250 && d->columns >= 900 ) {
+        gi[n] = 250; gj[n] = 900; n++;
+    }
+    for(i = diag-5 > 1 ? diag-5 : 1; i <= diag; i++) {
+        gi[n] = i; gj[n] = i; n++;
+    }
+
+    for(i = 0; i < n; i++) {
+        int li = gi[i] - d->row0, lj = gj[i] - d->col0;
+        mine[i] = ( li >= 1 && li <= T->rows && lj >= 1 && lj <= T->columns ) ? GRID(T,li,lj) : 0.0;
+    }
+    MPI_Reduce( mine, all, n, MPI_DOUBLE, MPI_SUM, 0, d->comm );
+
+    if ( d->rank ) return;
+
+    printf("---------- Iteration number: %d ------------\n", iteration);
+    for(i = 0; i < n; i++) {
+        printf("[%d,%d]: %5.2f  ", gi[i], gj[i], all[i]);
+    }
+    printf( "  max error=%7.4f  ", dt );
+    printf("\n");
+}
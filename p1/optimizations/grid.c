@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "grid.h"
+
+// zero interior rows with the same static schedule the sweeps use, so on a
+// NUMA machine each row's pages land on the socket of the thread sweeping it
+static int parallel_touch = 1;
+
+void grid_first_touch( int parallel ) {
+    parallel_touch = parallel;
+}
+
+// allocate a zeroed (rows+2) x (columns+2) grid with GRID_ALIGN aligned rows
+grid_t* grid_alloc( int rows, int columns ) {
+    grid_t* g = (grid_t*)malloc( sizeof(grid_t) );
+    if ( g == NULL ) {
+        fprintf( stderr, "grid_alloc: out of memory\n" );
+        exit(1);
+    }
+
+    int per_line = GRID_ALIGN / sizeof(double);
+    g->rows    = rows;
+    g->columns = columns;
+    g->stride  = ((columns + 2 + per_line - 1) / per_line) * per_line;
+
+    if ( posix_memalign( (void**)&g->data, GRID_ALIGN, grid_bytes(g) ) != 0 ) {
+        fprintf( stderr, "grid_alloc: cannot allocate %dx%d grid (%zu bytes)\n",
+                 rows, columns, grid_bytes(g) );
+        exit(1);
+    }
+
+    if ( parallel_touch ) {
+        size_t row_bytes = (size_t)g->stride * sizeof(double);
+        int i;
+
+        memset( g->data, 0, row_bytes );
+        #pragma omp parallel for schedule(static)
+        for ( i = 1; i <= rows; i++ )
+            memset( g->data + (size_t)i * g->stride, 0, row_bytes );
+        memset( g->data + (size_t)(rows+1) * g->stride, 0, row_bytes );
+    }
+    else {
+        memset( g->data, 0, grid_bytes(g) );
+    }
+    return g;
+}
+
+void grid_free( grid_t* g ) {
+    if ( g == NULL ) return;
+    free( g->data );
+    free( g );
+}
+
+size_t grid_bytes( const grid_t* g ) {
+    return (size_t)(g->rows + 2) * g->stride * sizeof(double);
+}
+
+static const char* mode_names[MODE_COUNT] = { "jacobi", "tb", "rbgs", "sor", "mg", "float", "mixed", "tiled", "active" };
+static const char* smoother_names[SMOOTH_COUNT] = { "rbgs", "jacobi" };
+static const char* pin_names[PIN_COUNT] = { "none", "compact", "scatter" };
+
+const char* mode_name( solver_t mode ) {
+    return mode_names[mode];
+}
+
+const char* smoother_name( mg_smoother_t smoother ) {
+    return smoother_names[smoother];
+}
+
+const char* pin_name( pin_t pin ) {
+    return pin_names[pin];
+}
+
+static void usage( const char* prog ) {
+    fprintf( stderr, "usage: %s [-r rows] [-c columns] [-e max_temp_error] [-n max_iterations]\n"
+                     "       [-m jacobi|tb|rbgs|sor|mg|float|mixed|tiled|active] [-k sweeps] [-b tile_rowsxtile_cols] [-w omega]\n"
+                     "       [-s rbgs|jacobi] [-C check_interval] [-A]\n"
+                     "       [-P none|compact|scatter] [-F serial|parallel]\n"
+                     "       [-x checkpoint_interval] [-X checkpoint_file] [-R] [-B boundary_file]\n", prog );
+    exit(1);
+}
+
+// read plate size and tolerance from the command line, defaults from config.h
+void parse_params( int argc, char *argv[], params_t* p ) {
+    int opt;
+
+    p->rows           = ROWS;
+    p->columns        = COLUMNS;
+    p->max_temp_error = MAX_TEMP_ERROR;
+    p->max_iterations = 0;
+    p->mode           = MODE_JACOBI;
+    p->sweeps         = TB_SWEEPS;
+    p->tile_rows      = TILE_ROWS;
+    p->tile_cols      = TILE_COLS;
+    p->autotune       = 1;
+    p->omega          = 0.0;
+    p->smoother       = SMOOTH_RBGS;
+    p->check_interval = 1;
+    p->async_check    = 0;
+    p->pin            = PIN_NONE;
+    p->parallel_touch = 1;
+    p->checkpoint_interval = 0;
+    p->checkpoint_file     = CHECKPOINT_FILE;
+    p->restart             = 0;
+    p->boundary_file       = NULL;
+
+    while ( (opt = getopt( argc, argv, "r:c:e:n:m:k:b:w:s:C:AP:F:x:X:RB:" )) != -1 ) {
+        switch ( opt ) {
+        case 'r': p->rows           = atoi( optarg ); break;
+        case 'c': p->columns        = atoi( optarg ); break;
+        case 'e': p->max_temp_error = atof( optarg ); break;
+        case 'n': p->max_iterations = atoi( optarg ); break;
+        case 'k': p->sweeps         = atoi( optarg ); break;
+        case 'w': p->omega          = atof( optarg ); break;
+        case 'C': p->check_interval = atoi( optarg ); break;
+        case 'A': p->async_check    = 1; break;
+        case 'x': p->checkpoint_interval = atoi( optarg ); break;
+        case 'X': p->checkpoint_file     = optarg; break;
+        case 'R': p->restart             = 1; break;
+        case 'B': p->boundary_file       = optarg; break;
+        case 'b':
+            if ( sscanf( optarg, "%dx%d", &p->tile_rows, &p->tile_cols ) != 2 ) usage( argv[0] );
+            p->autotune = 0;
+            break;
+        case 'm':
+            for ( p->mode = 0; p->mode < MODE_COUNT; p->mode++ )
+                if ( strcmp( optarg, mode_names[p->mode] ) == 0 ) break;
+            if ( p->mode == MODE_COUNT ) usage( argv[0] );
+            break;
+        case 'P':
+            for ( p->pin = 0; p->pin < PIN_COUNT; p->pin++ )
+                if ( strcmp( optarg, pin_names[p->pin] ) == 0 ) break;
+            if ( p->pin == PIN_COUNT ) usage( argv[0] );
+            break;
+        case 'F':
+            if      ( strcmp( optarg, "serial" ) == 0 )   p->parallel_touch = 0;
+            else if ( strcmp( optarg, "parallel" ) == 0 ) p->parallel_touch = 1;
+            else usage( argv[0] );
+            break;
+        case 's':
+            for ( p->smoother = 0; p->smoother < SMOOTH_COUNT; p->smoother++ )
+                if ( strcmp( optarg, smoother_names[p->smoother] ) == 0 ) break;
+            if ( p->smoother == SMOOTH_COUNT ) usage( argv[0] );
+            break;
+        default:  usage( argv[0] );
+        }
+    }
+
+    if ( p->rows < 1 || p->columns < 1 || p->max_temp_error <= 0.0 ) usage( argv[0] );
+    if ( p->max_iterations < 0 ) usage( argv[0] );
+    if ( p->sweeps < 1 || p->tile_rows < 1 || p->tile_cols < 1 ) usage( argv[0] );
+    if ( p->omega >= 2.0 || p->check_interval < 1 ) usage( argv[0] );
+    if ( p->checkpoint_interval < 0 ) usage( argv[0] );
+
+    grid_first_touch( p->parallel_touch );
+}
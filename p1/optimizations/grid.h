@@ -0,0 +1,163 @@
+#ifndef __GRID_H__
+#define __GRID_H__
+
+#include <stddef.h>
+
+// Heap allocated temperature grid.  The plate interior is rows x columns;
+// row 0, row rows+1, column 0 and column columns+1 hold the boundary.
+// Each row is padded out to stride doubles so every row starts on a
+// GRID_ALIGN byte boundary.
+typedef struct {
+    int rows;        // interior rows
+    int columns;     // interior columns
+    int stride;      // doubles between the start of consecutive rows
+    double* data;    // (rows+2) * stride doubles, GRID_ALIGN aligned
+} grid_t;
+
+#define GRID(g,i,j) ((g)->data[(size_t)(i)*(g)->stride + (j)])
+
+// solver used by the driver's main loop
+typedef enum {
+    MODE_JACOBI,     // one jacobi_loop sweep per pass
+    MODE_TB,         // temporally blocked, several sweeps per tile per pass
+    MODE_RBGS,       // red-black Gauss-Seidel, in place
+    MODE_SOR,        // red-black successive over-relaxation, in place
+    MODE_MG,         // geometric multigrid V-cycles
+    MODE_FLOAT,      // jacobi sweeps in single precision
+    MODE_MIXED,      // float sweeps plus double precision iterative refinement
+    MODE_TILED,      // jacobi swept in cache sized 2D tiles
+    MODE_ACTIVE,     // tiled jacobi that skips tiles which have stopped changing
+    MODE_COUNT
+} solver_t;
+
+// multigrid smoother
+typedef enum {
+    SMOOTH_RBGS,
+    SMOOTH_JACOBI,
+    SMOOTH_COUNT
+} mg_smoother_t;
+
+// thread pinning policy
+typedef enum {
+    PIN_NONE,
+    PIN_COMPACT,     // fill one socket before the next
+    PIN_SCATTER,     // round-robin over sockets
+    PIN_COUNT
+} pin_t;
+
+// plate edges, in the order spec files and bc.c index them
+typedef enum {
+    EDGE_TOP,        // row 0
+    EDGE_BOTTOM,     // row rows+1
+    EDGE_LEFT,       // column 0
+    EDGE_RIGHT,      // column columns+1
+    EDGE_COUNT
+} edge_side_t;
+
+typedef enum {
+    BC_DIRICHLET,    // fixed temperature
+    BC_NEUMANN       // fixed difference to the neighbouring interior cell
+} bc_type_t;
+
+// run time problem description shared by the drivers
+typedef struct {
+    int rows;
+    int columns;
+    double max_temp_error;
+    int max_iterations;      // iteration cap, 0 asks for it on stdin
+    solver_t mode;
+    int sweeps;      // sweeps per pass (and per convergence check) for -m tb
+    int tile_rows;   // tile shape for blocked modes
+    int tile_cols;
+    int autotune;    // -m tiled: pick the tile shape on the first sweeps (cleared by -b)
+    double omega;    // over-relaxation factor for -m sor, <= 0 picks the optimum
+    mg_smoother_t smoother;  // smoother for -m mg
+    int check_interval;      // sweeps between convergence checks (jacobi, lap-mpi)
+    int async_check;         // lap-mpi: overlap the check reduction with the next sweep
+    pin_t pin;               // thread pinning
+    int parallel_touch;      // zero new grids from the threads that sweep them
+    int checkpoint_interval; // sweeps between snapshots, 0 disables checkpointing
+    const char* checkpoint_file;
+    int restart;             // resume from the newest snapshot in checkpoint_file
+    const char* boundary_file;   // edge and source spec, NULL for the default plate
+} params_t;
+
+grid_t* grid_alloc( int rows, int columns );
+void    grid_first_touch( int parallel );
+void    grid_free( grid_t* g );
+size_t  grid_bytes( const grid_t* g );
+
+void parse_params( int argc, char *argv[], params_t* p );
+const char* mode_name( solver_t mode );
+const char* smoother_name( mg_smoother_t smoother );
+const char* pin_name( pin_t pin );
+
+// boundary conditions and heat sources, see bc.c
+typedef struct boundary boundary_t;
+
+boundary_t*   bc_default( int rows, int columns );
+boundary_t*   bc_load( const char* path, int rows, int columns );
+void          bc_free( boundary_t* bc );
+int           bc_dynamic( const boundary_t* bc );
+const grid_t* bc_source( const boundary_t* bc );
+void          bc_apply( const boundary_t* bc, grid_t* g );
+void          bc_edges( const boundary_t* bc, grid_t* g );
+double        bc_source_loop( int row, int columns, int stride, double *restrict Temp,
+                              double *restrict Temp_last, const double *restrict source );
+
+// mmap'ed double buffered snapshots written from a background thread, see checkpoint.c
+typedef struct checkpoint checkpoint_t;
+
+checkpoint_t* ckpt_open( const char* path, const grid_t* g );
+double*       ckpt_begin( checkpoint_t* ck );
+void          ckpt_commit( checkpoint_t* ck, int iteration );
+void          ckpt_save( checkpoint_t* ck, const grid_t* g, int iteration );
+void          ckpt_close( checkpoint_t* ck );
+int           ckpt_restore( const char* path, grid_t* g );
+
+// thread and page placement, see numa.c
+int  cpu_package( int cpu );
+int  num_packages( void );
+void pin_threads( pin_t policy );
+int  page_nodes( const void* p, size_t bytes, long* pages, int max_nodes );
+
+// temporally blocked jacobi, see jac_tb.c
+double jacobi_tb( grid_t* T, const grid_t* T_last, int sweeps, int tile_rows, int tile_cols );
+
+// cache blocked jacobi with tile shape autotuning, see jac_tiled.c
+typedef struct tiler tiler_t;
+
+double   jacobi_tiled( grid_t* T, const grid_t* T_last, int tile_rows, int tile_cols );
+tiler_t* tiler_create( int rows, int columns, int tile_rows, int tile_cols );
+void     tiler_destroy( tiler_t* tl );
+double   tiler_sweep( tiler_t* tl, grid_t* T, const grid_t* T_last );
+void     tiler_report( const tiler_t* tl );
+
+// tiled jacobi with per tile convergence masks, see jac_active.c
+typedef struct active active_t;
+
+active_t* active_create( int rows, int columns, int tile_rows, int tile_cols, double tol );
+void      active_destroy( active_t* a );
+double    active_sweep( active_t* a, grid_t* T, grid_t* T_last, int full );
+void      active_report( const active_t* a );
+double    active_work( const active_t* a );
+
+// in place red-black Gauss-Seidel / SOR, see rb.c
+double redblack_sweep( grid_t* T, double omega );
+double sor_optimal_omega( int rows, int columns );
+
+// single and mixed precision jacobi, see mixed.c
+double precision_solve( grid_t* T, solver_t mode, int max_iterations, double tol,
+                        int* iterations, size_t* bytes );
+double max_difference( const grid_t* a, const grid_t* b );
+
+// multigrid V-cycle solver, see mg.c
+typedef struct multigrid multigrid_t;
+
+multigrid_t* mg_create( grid_t* T, mg_smoother_t smoother );
+void         mg_destroy( multigrid_t* mg );
+double       mg_vcycle( multigrid_t* mg );
+int          mg_levels( const multigrid_t* mg );
+size_t       mg_bytes( const multigrid_t* mg );
+
+#endif
@@ -1,19 +1,23 @@
 #include <math.h>
-#include "config.h"
 #include <stdio.h>
 
-extern double Temperature[ROWS+2][COLUMNS+2];
-extern double Temperature_last[ROWS+2][COLUMNS+2];
-
-double jacobi_loop( int row, double* Temp, double* Temp_last ) {
+// update one interior row; rows are stride doubles apart
+double jacobi_loop( int row, int columns, int stride, double* Temp, double* Temp_last ) {
     double dt = 0.0;
-    if ( row == 1000 ) printf( "Temperature[%d][1000] = %5.2f, Temperature_last[%d][1000] = %5.2f\n", row, Temperature[row][1000], row, Temperature_last[row][1000] );
-    for( int j=1; j <= COLUMNS; j++ ) {
-        Temperature[row][j] = 0.25 * ( Temperature_last[row][j-1] + Temperature_last[row][j+1] +
-                                       Temperature_last[row-1][j] + Temperature_last[row+1][j] );
+    double* T      = Temp + (size_t)row * stride;
+    double* T_last = Temp_last + (size_t)row * stride;
+
+    for( int j=1; j <= columns; j++ ) {
+        T[j] = 0.25 * ( T_last[j-1] + T_last[j+1] +
+                        T_last[j-stride] + T_last[j+stride] );
 
-        // dt = fmax( dt, fabs( Temperature[row][j] - Temperature_last[row][j] ) );
+        // dt = fmax( dt, fabs( T[j] - T_last[j] ) );
     }
 
     return dt;
 }
+
+// only the one loop here; jac2.c picks between vector kernels
+const char* jacobi_kernel( void ) {
+    return "scalar";
+}
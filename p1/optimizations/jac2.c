@@ -1,21 +1,104 @@
 #include <math.h>
 #include <stdio.h>
-#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
 
-extern double Temperature[ROWS+2][COLUMNS+2];
-extern double Temperature_last[ROWS+2][COLUMNS+2];
+// Fused Jacobi row update: writes the new row and returns its largest change
+// in the same pass.  The body is picked once at run time from CPUID (or the
+// LAP_KERNEL environment variable: scalar, avx2 or avx512); every version
+// adds the four neighbours in the same order, so results are bit-identical.
 
-double jacobi_loop( int row, double *restrict Temp, double *restrict Temp_last ) {
+typedef double (*row_kernel_t)( const double *restrict, double *restrict, int, int );
+
+static double row_scalar( const double *restrict Tl, double *restrict T, int columns, int stride ) {
     double dt = 0.0;
-    int off1 = row * (COLUMNS+2);
-    int off0 = off1 - (COLUMNS+2);
-    int off2 = off1 + (COLUMNS+2);
 
-    for( int j=1; j <= COLUMNS; j++ ) {
-        Temp[off1+j] = 0.25 * ( Temp_last[off1+j-1] + Temp_last[off1+j+1] +
-                                Temp_last[off0+j] + Temp_last[off2+j] );
+    for( int j=1; j <= columns; j++ ) {
+        T[j] = 0.25 * ( Tl[j-1] + Tl[j+1] + Tl[j-stride] + Tl[j+stride] );
+        dt = fmax( dt, fabs( T[j] - Tl[j] ) );
+    }
+    return dt;
+}
+
+__attribute__((target("avx2")))
+static double row_avx2( const double *restrict Tl, double *restrict T, int columns, int stride ) {
+    const __m256d quarter = _mm256_set1_pd( 0.25 );
+    const __m256d sign    = _mm256_set1_pd( -0.0 );
+    __m256d vdt = _mm256_setzero_pd();
+    double dt;
+    int j;
+
+    for( j=1; j+3 <= columns; j+=4 ) {
+        __m256d c = _mm256_loadu_pd( Tl+j );
+        __m256d s = _mm256_add_pd( _mm256_loadu_pd( Tl+j-1 ), _mm256_loadu_pd( Tl+j+1 ) );
+        s = _mm256_add_pd( s, _mm256_loadu_pd( Tl+j-stride ) );
+        s = _mm256_add_pd( s, _mm256_loadu_pd( Tl+j+stride ) );
+        s = _mm256_mul_pd( s, quarter );
+        _mm256_storeu_pd( T+j, s );
+        vdt = _mm256_max_pd( vdt, _mm256_andnot_pd( sign, _mm256_sub_pd( s, c ) ) );
+    }
+
+    __m128d m = _mm_max_pd( _mm256_castpd256_pd128( vdt ), _mm256_extractf128_pd( vdt, 1 ) );
+    dt = fmax( _mm_cvtsd_f64( m ), _mm_cvtsd_f64( _mm_unpackhi_pd( m, m ) ) );
 
-        dt = fmax( dt, fabs( Temp[off1+j] - Temp_last[off1+j] ) );
+    for( ; j <= columns; j++ ) {
+        T[j] = 0.25 * ( Tl[j-1] + Tl[j+1] + Tl[j-stride] + Tl[j+stride] );
+        dt = fmax( dt, fabs( T[j] - Tl[j] ) );
     }
     return dt;
 }
+
+__attribute__((target("avx512f")))
+static double row_avx512( const double *restrict Tl, double *restrict T, int columns, int stride ) {
+    const __m512d quarter = _mm512_set1_pd( 0.25 );
+    __m512d vdt = _mm512_setzero_pd();
+    int j;
+
+    for( j=1; j <= columns; j+=8 ) {
+        // the tail is handled by masking rather than a scalar loop
+        __mmask8 k = columns - j >= 7 ? 0xff : (__mmask8)((1u << (columns - j + 1)) - 1);
+        __m512d c = _mm512_maskz_loadu_pd( k, Tl+j );
+        __m512d s = _mm512_add_pd( _mm512_maskz_loadu_pd( k, Tl+j-1 ), _mm512_maskz_loadu_pd( k, Tl+j+1 ) );
+        s = _mm512_add_pd( s, _mm512_maskz_loadu_pd( k, Tl+j-stride ) );
+        s = _mm512_add_pd( s, _mm512_maskz_loadu_pd( k, Tl+j+stride ) );
+        s = _mm512_mul_pd( s, quarter );
+        _mm512_mask_storeu_pd( T+j, k, s );
+        vdt = _mm512_mask_max_pd( vdt, k, vdt, _mm512_abs_pd( _mm512_sub_pd( s, c ) ) );
+    }
+    return _mm512_reduce_max_pd( vdt );
+}
+
+static row_kernel_t row_kernel;
+static const char*  row_kernel_name;
+
+static void select_kernel( void ) {
+    const char* want = getenv( "LAP_KERNEL" );
+
+    __builtin_cpu_init();
+    if ( (!want || strcmp( want, "avx512" ) == 0) && __builtin_cpu_supports( "avx512f" ) ) {
+        row_kernel_name = "avx512";
+        row_kernel = row_avx512;
+    }
+    else if ( (!want || strcmp( want, "scalar" ) != 0) && __builtin_cpu_supports( "avx2" ) ) {
+        row_kernel_name = "avx2";
+        row_kernel = row_avx2;
+    }
+    else {
+        row_kernel_name = "scalar";
+        row_kernel = row_scalar;
+    }
+}
+
+// Pick the row kernel and return its name.  Drivers call this once before
+// their first parallel sweep; jacobi_loop assumes it has been done.
+const char* jacobi_kernel( void ) {
+    if ( row_kernel == NULL ) select_kernel();
+    return row_kernel_name;
+}
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last ) {
+    size_t off1 = (size_t)row * stride;
+
+    return row_kernel( Temp_last + off1, Temp + off1, columns, stride );
+}
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "grid.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+
+// Active tile Jacobi.  The plate is cut into tiles as in jac_tiled.c and
+// each tile remembers the largest change of the last sweep that computed
+// it.  A tile is hot while that change, or the change of one of its four
+// neighbours, is at least tol / ACTIVE_REVALIDATE, so a frozen tile drifts
+// by less than the tolerance between two full sweeps; a tile that has not
+// been hot for ACTIVE_QUIET sweeps is frozen and skipped.  Freezing copies the tile's
+// newest values into the other grid too, so both grids agree on it and it
+// acts like fixed boundary for its neighbours.  Heat arriving from a hot
+// neighbour wakes a frozen tile on the next sweep, and a full sweep (the
+// caller asks for one every ACTIVE_REVALIDATE sweeps and before accepting
+// convergence) recomputes and rechecks every tile.
+
+struct active {
+    int     tiles_i, tiles_j;
+    int     tile_rows, tile_cols;
+    double  tol;           // per sweep change below which a tile is quiet
+    double* delta;         // change of the last sweep that computed the tile
+    int*    quiet;         // consecutive sweeps the tile was not hot
+    int*    list;          // tiles to compute this sweep
+    char*   computed;
+    long    updates;       // tile sweeps done / possible
+    long    possible;
+};
+
+active_t* active_create( int rows, int columns, int tile_rows, int tile_cols, double tol ) {
+    active_t* a = (active_t*)calloc( 1, sizeof(active_t) );
+
+    a->tile_rows = tile_rows;
+    a->tile_cols = tile_cols;
+    a->tiles_i   = (rows + tile_rows - 1) / tile_rows;
+    a->tiles_j   = (columns + tile_cols - 1) / tile_cols;
+    a->tol       = tol / ACTIVE_REVALIDATE;
+
+    int n = a->tiles_i * a->tiles_j;
+    a->delta    = (double*)calloc( n, sizeof(double) );
+    a->quiet    = (int*)calloc( n, sizeof(int) );
+    a->list     = (int*)calloc( n, sizeof(int) );
+    a->computed = (char*)calloc( n, 1 );
+    return a;
+}
+
+void active_destroy( active_t* a ) {
+    free( a->delta );
+    free( a->quiet );
+    free( a->list );
+    free( a->computed );
+    free( a );
+}
+
+static int is_hot( const active_t* a, int ti, int tj ) {
+    const double* d = a->delta + ti * a->tiles_j + tj;
+
+    return d[0] >= a->tol
+        || ( ti > 0              && d[-a->tiles_j] >= a->tol )
+        || ( ti < a->tiles_i - 1 && d[ a->tiles_j] >= a->tol )
+        || ( tj > 0              && d[-1] >= a->tol )
+        || ( tj < a->tiles_j - 1 && d[ 1] >= a->tol );
+}
+
+// One sweep T_last -> T over the active tiles, or over every tile if full.
+// Returns the largest change of the tiles it computed.
+double active_sweep( active_t* a, grid_t* T, grid_t* T_last, int full ) {
+    int rows    = T->rows;
+    int columns = T->columns;
+    int stride  = T->stride;
+    int ntiles  = a->tiles_i * a->tiles_j;
+    int n = 0;
+    double dt = 0.0;
+    int t, k;
+
+    for ( t = 0; t < ntiles; t++ ) {
+        a->computed[t] = ( full || a->quiet[t] < ACTIVE_QUIET );
+        if ( a->computed[t] ) a->list[n++] = t;
+    }
+    a->updates  += n;
+    a->possible += ntiles;
+
+    #pragma omp parallel for schedule(static) reduction(max:dt)
+    for ( k = 0; k < n; k++ ) {
+        int t  = a->list[k];
+        int i0 = 1 + (t / a->tiles_j) * a->tile_rows;
+        int j0 = 1 + (t % a->tiles_j) * a->tile_cols;
+        int i1 = MIN( i0 + a->tile_rows, rows + 1 );
+        int width = MIN( a->tile_cols, columns + 1 - j0 );
+        double d = 0.0;
+        int i;
+
+        for ( i = i0; i < i1; i++ )
+            d = fmax( d, jacobi_loop( i, width, stride, T->data + j0 - 1, T_last->data + j0 - 1 ) );
+        a->delta[t] = d;
+        dt = fmax( dt, d );
+    }
+
+    for ( t = 0; t < ntiles; t++ )
+        a->quiet[t] = is_hot( a, t / a->tiles_j, t % a->tiles_j ) ? 0 : a->quiet[t] + 1;
+
+    // tiles frozen from now on take their newest values into both grids;
+    // nobody reads T_last again before the swap, so this cannot race
+    #pragma omp parallel for schedule(static)
+    for ( t = 0; t < ntiles; t++ ) {
+        if ( !a->computed[t] || a->quiet[t] < ACTIVE_QUIET ) continue;
+
+        int i0 = 1 + (t / a->tiles_j) * a->tile_rows;
+        int j0 = 1 + (t % a->tiles_j) * a->tile_cols;
+        int i1 = MIN( i0 + a->tile_rows, rows + 1 );
+        int width = MIN( a->tile_cols, columns + 1 - j0 );
+        int i;
+
+        for ( i = i0; i < i1; i++ )
+            memcpy( T_last->data + (size_t)i*stride + j0, T->data + (size_t)i*stride + j0,
+                    width * sizeof(double) );
+    }
+    return dt;
+}
+
+// " (<rows>x<cols> tiles, ...)" for the driver's solver line
+void active_report( const active_t* a ) {
+    printf(" (%dx%d tiles, %d tiles, full sweep every %d, %.1f%% of tile sweeps skipped)",
+           a->tile_rows, a->tile_cols, a->tiles_i * a->tiles_j, ACTIVE_REVALIDATE,
+           a->possible ? 100.0 * (a->possible - a->updates) / a->possible : 0.0);
+}
+
+// fraction of the cell updates a full sweep per iteration would have done
+double active_work( const active_t* a ) {
+    return a->possible ? (double)a->updates / a->possible : 1.0;
+}
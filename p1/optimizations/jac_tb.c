@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "grid.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+
+// Temporally blocked Jacobi.  Advances T_last by `sweeps` steps into T, one
+// tile at a time, with overlapped (ghost zone) tiles: each tile copies its
+// cells plus a halo `sweeps` wide into a pair of thread private buffers,
+// ping-pongs between them while the updated region shrinks by one cell per
+// sweep, and writes only its own cells back to T.  Tiles only read T_last so
+// they are independent.  Rows go through the same jacobi_loop row kernel as
+// -m jacobi, so the result matches `sweeps` plain passes exactly.
+//
+// Returns the largest change of the final sweep, i.e. what jacobi_loop would
+// have reported for that sweep.
+double jacobi_tb( grid_t* T, const grid_t* T_last, int sweeps, int tile_rows, int tile_cols ) {
+    int rows    = T->rows;
+    int columns = T->columns;
+    int tiles_i = (rows + tile_rows - 1) / tile_rows;
+    int tiles_j = (columns + tile_cols - 1) / tile_cols;
+    int lstride = tile_cols + 2*sweeps;
+    size_t lsize = (size_t)(tile_rows + 2*sweeps) * lstride;
+    double dt = 0.0;
+
+    #pragma omp parallel reduction(max:dt)
+    {
+        double* buf = (double*)malloc( 2 * lsize * sizeof(double) );
+        if ( buf == NULL ) {
+            fprintf( stderr, "jacobi_tb: out of memory\n" );
+            exit(1);
+        }
+
+        int t;
+        #pragma omp for schedule(static)
+        for ( t = 0; t < tiles_i * tiles_j; t++ ) {
+            int i0 = (t / tiles_j) * tile_rows + 1;
+            int j0 = (t % tiles_j) * tile_cols + 1;
+            int i1 = MIN( i0 + tile_rows - 1, rows );
+            int j1 = MIN( j0 + tile_cols - 1, columns );
+
+            // footprint: tile plus halo, clipped to the grid including boundary
+            int fi0 = MAX( i0 - sweeps, 0 ), fi1 = MIN( i1 + sweeps, rows + 1 );
+            int fj0 = MAX( j0 - sweeps, 0 ), fj1 = MIN( j1 + sweeps, columns + 1 );
+            size_t width = (size_t)(fj1 - fj0 + 1) * sizeof(double);
+
+            double* a = buf;
+            double* b = buf + lsize;
+            int i, s;
+
+            // every sweep writes all the interior cells the next one reads,
+            // so b only needs the plate boundary cells inside the footprint
+            for ( i = fi0; i <= fi1; i++ ) {
+                double* ra = a + (size_t)(i-fi0)*lstride;
+                double* rb = b + (size_t)(i-fi0)*lstride;
+
+                memcpy( ra, &GRID(T_last,i,fj0), width );
+                if ( i == 0 || i == rows + 1 ) {
+                    memcpy( rb, ra, width );
+                    continue;
+                }
+                if ( fj0 == 0 ) rb[0] = ra[0];
+                if ( fj1 == columns + 1 ) rb[fj1-fj0] = ra[fj1-fj0];
+            }
+
+            for ( s = 1; s <= sweeps; s++ ) {
+                int grow = sweeps - s;
+                int ui0 = MAX( i0 - grow, 1 ), ui1 = MIN( i1 + grow, rows );
+                int uj0 = MAX( j0 - grow, 1 ), uj1 = MIN( j1 + grow, columns );
+                int last = ( s == sweeps );
+
+                // jacobi_loop updates columns 1..n of row 0 of the pointers
+                // it is given, so aim it one cell left of the run
+                for ( i = ui0; i <= ui1; i++ ) {
+                    size_t off = (size_t)(i-fi0)*lstride + (uj0-fj0) - 1;
+                    double d = jacobi_loop( 0, uj1 - uj0 + 1, lstride, b + off, a + off );
+                    if ( last ) dt = fmax( dt, d );
+                }
+
+                double* tmp = a;
+                a = b;
+                b = tmp;
+            }
+
+            // a holds the newest values; write back only the tile itself
+            for ( i = i0; i <= i1; i++ )
+                memcpy( &GRID(T,i,j0), a + (size_t)(i-fi0)*lstride + (j0-fj0),
+                        (size_t)(j1 - j0 + 1) * sizeof(double) );
+        }
+
+        free( buf );
+    }
+
+    return dt;
+}
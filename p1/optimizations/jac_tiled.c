@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "grid.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+
+// Spatially blocked Jacobi.  The plate is cut into tile_rows x tile_cols
+// tiles and each tile is swept row by row with the jacobi_loop kernel on a
+// row segment, so the three T_last rows a segment reads stay in L2 while
+// the next row of the same tile is computed.  Returns the largest change.
+double jacobi_tiled( grid_t* T, const grid_t* T_last, int tile_rows, int tile_cols ) {
+    int rows    = T->rows;
+    int columns = T->columns;
+    int stride  = T->stride;
+    int tiles_i = (rows + tile_rows - 1) / tile_rows;
+    int tiles_j = (columns + tile_cols - 1) / tile_cols;
+    double dt = 0.0;
+    int t;
+
+    #pragma omp parallel for schedule(static) reduction(max:dt)
+    for ( t = 0; t < tiles_i * tiles_j; t++ ) {
+        int i0 = 1 + (t / tiles_j) * tile_rows;
+        int j0 = 1 + (t % tiles_j) * tile_cols;
+        int i1 = MIN( i0 + tile_rows, rows + 1 );
+        int width = MIN( tile_cols, columns + 1 - j0 );
+        int i;
+
+        // shift the row base so the kernel's column 1 is column j0
+        for ( i = i0; i < i1; i++ )
+            dt = fmax( dt, jacobi_loop( i, width, stride, T->data + j0 - 1, T_last->data + j0 - 1 ) );
+    }
+    return dt;
+}
+
+// Autotuner: the first sweeps of the run try each candidate tile shape for
+// TUNE_SWEEPS sweeps, keeping the fastest, and every later sweep uses it.
+// Candidate 0 is full width row bands, i.e. the untiled sweep, and is the
+// baseline for the reported speedup.
+
+struct tiler {
+    int     ncand;
+    int     (*cand)[2];    // rows, cols of each candidate
+    double* best_time;     // fastest sweep seen for each candidate
+    int     current;       // candidate being timed, ncand once tuning is done
+    int     sweeps;        // sweeps spent on the current candidate
+    int     best;
+};
+
+static double now( void ) {
+    struct timeval t;
+    gettimeofday( &t, NULL );
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void add_candidate( tiler_t* tl, int tile_rows, int tile_cols ) {
+    tl->cand[tl->ncand][0] = tile_rows;
+    tl->cand[tl->ncand][1] = tile_cols;
+    tl->best_time[tl->ncand] = HUGE_VAL;
+    tl->ncand++;
+}
+
+// tile_rows/tile_cols > 0 fixes the shape, otherwise it is autotuned
+tiler_t* tiler_create( int rows, int columns, int tile_rows, int tile_cols ) {
+    static const int heights[] = { 16, 64, 256 };
+    static const int widths[]  = { 4096, 2048, 1024, 512, 256 };
+    int nh = sizeof(heights) / sizeof(heights[0]);
+    int nw = sizeof(widths) / sizeof(widths[0]);
+    tiler_t* tl = (tiler_t*)calloc( 1, sizeof(tiler_t) );
+    int h, w;
+
+    tl->cand      = calloc( 1 + nh * nw, sizeof(*tl->cand) );
+    tl->best_time = calloc( 1 + nh * nw, sizeof(double) );
+
+    if ( tile_rows > 0 && tile_cols > 0 ) {
+        add_candidate( tl, tile_rows, tile_cols );
+        tl->current = tl->ncand;
+        return tl;
+    }
+
+    add_candidate( tl, MIN( heights[0], rows ), columns );
+    for ( w = 0; w < nw; w++ ) {
+        if ( widths[w] >= columns ) continue;
+        for ( h = 0; h < nh; h++ )
+            if ( heights[h] <= rows ) add_candidate( tl, heights[h], widths[w] );
+    }
+    return tl;
+}
+
+void tiler_destroy( tiler_t* tl ) {
+    free( tl->cand );
+    free( tl->best_time );
+    free( tl );
+}
+
+// one sweep with the candidate under test, or with the winner once tuned
+double tiler_sweep( tiler_t* tl, grid_t* T, const grid_t* T_last ) {
+    if ( tl->current == tl->ncand )
+        return jacobi_tiled( T, T_last, tl->cand[tl->best][0], tl->cand[tl->best][1] );
+
+    int c = tl->current;
+    double t = now();
+    double dt = jacobi_tiled( T, T_last, tl->cand[c][0], tl->cand[c][1] );
+    t = now() - t;
+
+    if ( t < tl->best_time[c] ) tl->best_time[c] = t;
+    if ( ++tl->sweeps == TUNE_SWEEPS ) {
+        if ( tl->best_time[c] < tl->best_time[tl->best] ) tl->best = c;
+        tl->sweeps = 0;
+        tl->current++;
+    }
+    return dt;
+}
+
+static void tiler_shape( const tiler_t* tl, int* tile_rows, int* tile_cols ) {
+    *tile_rows = tl->cand[tl->best][0];
+    *tile_cols = tl->cand[tl->best][1];
+}
+
+// "<rows>x<cols> tiles" plus how the choice was made
+void tiler_report( const tiler_t* tl ) {
+    int tile_rows, tile_cols;
+
+    tiler_shape( tl, &tile_rows, &tile_cols );
+    if ( tl->ncand == 1 )
+        printf(" (%dx%d tiles)", tile_rows, tile_cols);
+    else if ( tl->current < tl->ncand )
+        printf(" (%dx%d tiles, tuning stopped after %d of %d shapes)",
+               tile_rows, tile_cols, tl->current, tl->ncand);
+    else
+        printf(" (%dx%d tiles autotuned from %d shapes, %.2fx the untiled sweep)",
+               tile_rows, tile_cols, tl->ncand, tl->best_time[0] / tl->best_time[tl->best]);
+}
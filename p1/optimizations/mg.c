@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "config.h"
+#include "grid.h"
+
+// Geometric multigrid for the plate.  Level 0 is the temperature grid
+// itself (f = 0, fixed boundary); every coarser level has (n-1)/2 points
+// per side and solves for the correction of the level above it with zero
+// boundary values.  Coarse point I sits on fine point 2I, so for odd n the
+// coarse boundary lands on the fine boundary, and for even n on the last
+// fine row/column, which is then left to the smoother.  Mesh spacing on
+// level l is 2^l, so h^2 = 4^l.
+
+typedef struct {
+    grid_t* u;     // solution (level 0) or correction
+    grid_t* f;     // right hand side
+    grid_t* r;     // residual, also scratch for the jacobi smoother
+    double  h2;
+} mg_level_t;
+
+struct multigrid {
+    int         nlevels;
+    mg_level_t* level;
+    mg_smoother_t smoother;
+};
+
+// smoothers ------------------------------------------------------------------
+
+static void smooth_rbgs( mg_level_t* L ) {
+    grid_t* u = L->u;
+    int stride = u->stride;
+    int color, i, j;
+
+    for ( color = 0; color < 2; color++ ) {
+        #pragma omp parallel for private(j) schedule(static)
+        for ( i = 1; i <= u->rows; i++ ) {
+            double* t = u->data + (size_t)i * stride;
+            const double* f = L->f->data + (size_t)i * stride;
+            for ( j = 1 + ((i + 1 + color) & 1); j <= u->columns; j += 2 )
+                t[j] = 0.25 * ( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] + L->h2 * f[j] );
+        }
+    }
+}
+
+// weighted (omega = MG_JACOBI_WEIGHT) jacobi, staged through L->r
+static void smooth_jacobi( mg_level_t* L ) {
+    grid_t* u = L->u;
+    int stride = u->stride;
+    int i, j;
+
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 1; i <= u->rows; i++ ) {
+        const double* t = u->data + (size_t)i * stride;
+        const double* f = L->f->data + (size_t)i * stride;
+        double* s = L->r->data + (size_t)i * stride;
+        for ( j = 1; j <= u->columns; j++ )
+            s[j] = 0.25 * ( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] + L->h2 * f[j] );
+    }
+
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 1; i <= u->rows; i++ ) {
+        double* t = u->data + (size_t)i * stride;
+        const double* s = L->r->data + (size_t)i * stride;
+        for ( j = 1; j <= u->columns; j++ )
+            t[j] += MG_JACOBI_WEIGHT * ( s[j] - t[j] );
+    }
+}
+
+static void smooth( multigrid_t* mg, mg_level_t* L, int sweeps ) {
+    while ( sweeps-- > 0 ) {
+        if ( mg->smoother == SMOOTH_JACOBI ) smooth_jacobi( L );
+        else                                 smooth_rbgs( L );
+    }
+}
+
+// grid transfer --------------------------------------------------------------
+
+// r = f - A u
+static void residual( mg_level_t* L ) {
+    grid_t* u = L->u;
+    int stride = u->stride;
+    double inv_h2 = 1.0 / L->h2;
+    int i, j;
+
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 1; i <= u->rows; i++ ) {
+        const double* t = u->data + (size_t)i * stride;
+        const double* f = L->f->data + (size_t)i * stride;
+        double* r = L->r->data + (size_t)i * stride;
+        for ( j = 1; j <= u->columns; j++ )
+            r[j] = f[j] - inv_h2 * ( 4.0*t[j] - t[j-1] - t[j+1] - t[j-stride] - t[j+stride] );
+    }
+}
+
+// full weighting of the fine residual into the coarse right hand side;
+// the fine residual is zero on the boundary ring
+static void restrict_residual( const mg_level_t* fine, mg_level_t* coarse ) {
+    const grid_t* r = fine->r;
+    int fs = r->stride;
+    int I, J;
+
+    #pragma omp parallel for private(J) schedule(static)
+    for ( I = 1; I <= coarse->f->rows; I++ ) {
+        const double* r0 = r->data + (size_t)(2*I) * fs;
+        double* f = coarse->f->data + (size_t)I * coarse->f->stride;
+        for ( J = 1; J <= coarse->f->columns; J++ ) {
+            int j = 2*J;
+            f[J] = ( 4.0 * r0[j]
+                   + 2.0 * ( r0[j-1] + r0[j+1] + r0[j-fs] + r0[j+fs] )
+                   + r0[j-fs-1] + r0[j-fs+1] + r0[j+fs-1] + r0[j+fs+1] ) / 16.0;
+        }
+    }
+}
+
+// bilinear interpolation of the coarse correction, added onto the fine level
+static void prolong_correction( const mg_level_t* coarse, mg_level_t* fine ) {
+    const grid_t* e = coarse->u;
+    grid_t* u = fine->u;
+    int cs = e->stride;
+    int i, j;
+
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 1; i <= u->rows; i++ ) {
+        const double* e0 = e->data + (size_t)(i/2) * cs;
+        const double* e1 = e->data + (size_t)((i+1)/2) * cs;
+        double* t = u->data + (size_t)i * u->stride;
+        for ( j = 1; j <= u->columns; j++ ) {
+            int J0 = j/2, J1 = (j+1)/2;
+            t[j] += 0.25 * ( e0[J0] + e0[J1] + e1[J0] + e1[J1] );
+        }
+    }
+}
+
+static void vcycle( multigrid_t* mg, int l ) {
+    mg_level_t* L = &mg->level[l];
+
+    if ( l == mg->nlevels - 1 ) {
+        smooth( mg, L, MG_COARSE_SWEEPS );
+        return;
+    }
+
+    mg_level_t* C = &mg->level[l+1];
+
+    smooth( mg, L, MG_PRE_SWEEPS );
+    residual( L );
+    restrict_residual( L, C );
+
+    int i;
+    #pragma omp parallel for schedule(static)
+    for ( i = 0; i <= C->u->rows + 1; i++ ) {
+        double* e = C->u->data + (size_t)i * C->u->stride;
+        int j;
+        for ( j = 0; j <= C->u->columns + 1; j++ ) e[j] = 0.0;
+    }
+
+    vcycle( mg, l+1 );
+    prolong_correction( C, L );
+    smooth( mg, L, MG_POST_SWEEPS );
+}
+
+// public interface -----------------------------------------------------------
+
+// build the level hierarchy on top of T, which becomes level 0
+multigrid_t* mg_create( grid_t* T, mg_smoother_t smoother ) {
+    multigrid_t* mg = (multigrid_t*)malloc( sizeof(multigrid_t) );
+    int rows = T->rows, columns = T->columns;
+    int l;
+
+    mg->smoother = smoother;
+    mg->nlevels  = 1;
+    while ( rows >= 2*MG_COARSEST && columns >= 2*MG_COARSEST ) {
+        rows = (rows - 1) / 2;
+        columns = (columns - 1) / 2;
+        mg->nlevels++;
+    }
+
+    mg->level = (mg_level_t*)malloc( mg->nlevels * sizeof(mg_level_t) );
+    rows = T->rows;
+    columns = T->columns;
+    for ( l = 0; l < mg->nlevels; l++ ) {
+        mg_level_t* L = &mg->level[l];
+        L->u  = l == 0 ? T : grid_alloc( rows, columns );
+        L->f  = grid_alloc( rows, columns );
+        L->r  = grid_alloc( rows, columns );
+        L->h2 = pow( 4.0, l );
+        rows = (rows - 1) / 2;
+        columns = (columns - 1) / 2;
+    }
+    return mg;
+}
+
+void mg_destroy( multigrid_t* mg ) {
+    int l;
+    for ( l = 0; l < mg->nlevels; l++ ) {
+        if ( l > 0 ) grid_free( mg->level[l].u );
+        grid_free( mg->level[l].f );
+        grid_free( mg->level[l].r );
+    }
+    free( mg->level );
+    free( mg );
+}
+
+int mg_levels( const multigrid_t* mg ) {
+    return mg->nlevels;
+}
+
+// memory held by the hierarchy, not counting the level 0 temperature grid
+size_t mg_bytes( const multigrid_t* mg ) {
+    size_t bytes = 0;
+    int l;
+    for ( l = 0; l < mg->nlevels; l++ ) {
+        if ( l > 0 ) bytes += grid_bytes( mg->level[l].u );
+        bytes += grid_bytes( mg->level[l].f ) + grid_bytes( mg->level[l].r );
+    }
+    return bytes;
+}
+
+// One V-cycle.  Returns the largest change a jacobi sweep would now make,
+// which is the quantity the other modes test against MAX_TEMP_ERROR.
+double mg_vcycle( multigrid_t* mg ) {
+    grid_t* u = mg->level[0].u;
+    int stride = u->stride;
+    double dt = 0.0;
+    int i, j;
+
+    vcycle( mg, 0 );
+
+    #pragma omp parallel for private(j) reduction(max:dt) schedule(static)
+    for ( i = 1; i <= u->rows; i++ ) {
+        const double* t = u->data + (size_t)i * stride;
+        for ( j = 1; j <= u->columns; j++ )
+            dt = fmax( dt, fabs( 0.25 * ( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] ) - t[j] ) );
+    }
+    return dt;
+}
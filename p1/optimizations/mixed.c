@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pmmintrin.h>
+
+#include "config.h"
+#include "grid.h"
+
+// Single and mixed precision Jacobi.  The plate is copied into float planes
+// so the sweeps move half the bytes of double ones.  Mixed precision does
+// the bulk of the sweeps in float, stopping short of the tolerance, and then
+// always refines in double: the residual of the double field is computed in
+// double, the correction equation A e = r is relaxed in float, and e is
+// added back in double until the double field meets the tolerance.  The
+// double reference is the jacobi_loop sweep of -m jacobi.
+
+// a float copy of the plate, same layout as grid_t
+typedef struct {
+    int rows, columns, stride;
+    float* data;
+} plane_t;
+
+static plane_t* plane_alloc( int rows, int columns ) {
+    plane_t* p = (plane_t*)malloc( sizeof(plane_t) );
+    int per_line = GRID_ALIGN / sizeof(float);
+    p->rows = rows;
+    p->columns = columns;
+    p->stride = ((columns + 2 + per_line - 1) / per_line) * per_line;
+    if ( posix_memalign( (void**)&p->data, GRID_ALIGN,
+                         (size_t)(rows+2) * p->stride * sizeof(float) ) != 0 ) {
+        fprintf( stderr, "plane_alloc: out of memory\n" );
+        exit(1);
+    }
+    memset( p->data, 0, (size_t)(rows+2) * p->stride * sizeof(float) );
+    return p;
+}
+
+static void plane_free( plane_t* p ) {
+    free( p->data );
+    free( p );
+}
+
+static size_t plane_bytes( const plane_t* p ) {
+    return (size_t)(p->rows+2) * p->stride * sizeof(float);
+}
+
+// copy every cell, boundary included, from a double grid
+static void plane_load( plane_t* p, const grid_t* g ) {
+    int i, j;
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 0; i <= g->rows+1; i++ )
+        for ( j = 0; j <= g->columns+1; j++ )
+            p->data[(size_t)i*p->stride + j] = (float)GRID(g,i,j);
+}
+
+// one sweep of T = (sum of neighbours + rhs) / 4; returns largest change
+static double sweep( plane_t* T, const plane_t* Tl, const plane_t* rhs ) {
+    int stride = T->stride;
+    double dt = 0.0;
+    int i, j;
+    #pragma omp parallel for private(j) reduction(max:dt) schedule(static)
+    for ( i = 1; i <= T->rows; i++ ) {
+        float *restrict t = T->data + (size_t)i * stride;
+        const float *restrict l = Tl->data + (size_t)i * stride;
+        float m = 0;
+        if ( rhs ) {
+            const float *restrict f = rhs->data + (size_t)i * stride;
+            #pragma omp simd reduction(max:m)
+            for ( j = 1; j <= T->columns; j++ ) {
+                t[j] = 0.25f * ( l[j-1] + l[j+1] + l[j-stride] + l[j+stride] + f[j] );
+                float d = t[j] - l[j];
+                d = d < 0 ? -d : d;
+                m = d > m ? d : m;
+            }
+        }
+        else {
+            #pragma omp simd reduction(max:m)
+            for ( j = 1; j <= T->columns; j++ ) {
+                t[j] = 0.25f * ( l[j-1] + l[j+1] + l[j-stride] + l[j+stride] );
+                float d = t[j] - l[j];
+                d = d < 0 ? -d : d;
+                m = d > m ? d : m;
+            }
+        }
+        dt = fmax( dt, (double)m );
+    }
+    return dt;
+}
+
+// jacobi sweeps between a and b until the change drops below tol;
+// returns the last change, *which says which plane holds the result
+static double relax( plane_t* a, plane_t* b, const plane_t* rhs, double tol,
+                     int max_sweeps, int* sweeps, int* which ) {
+    double dt = HUGE_VAL;
+    *sweeps = 0;
+    *which = 0;
+    while ( dt > tol && *sweeps < max_sweeps ) {
+        dt = *which ? sweep( a, b, rhs ) : sweep( b, a, rhs );
+        *which = !*which;
+        (*sweeps)++;
+    }
+    return dt;
+}
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+
+// where float jacobi stops making progress on a plate with temperatures up
+// to 100: a few ulps of the largest value
+#define FLOAT_FLOOR ( 4.0 * 100.0 * FLT_EPSILON )
+
+// -m mixed leaves the float phase at this multiple of the tolerance and
+// gets the rest of the way with double refinement
+#define MIXED_LOOSEN 10.0
+
+// largest change one double precision jacobi sweep would make on T
+static double jacobi_change( const grid_t* T ) {
+    int stride = T->stride;
+    double dt = 0.0;
+    int i, j;
+
+    #pragma omp parallel for private(j) reduction(max:dt) schedule(static)
+    for ( i = 1; i <= T->rows; i++ ) {
+        const double* t = T->data + (size_t)i * stride;
+        for ( j = 1; j <= T->columns; j++ )
+            dt = fmax( dt, fabs( 0.25 * ( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] ) - t[j] ) );
+    }
+    return dt;
+}
+
+// Solve the plate held in T (boundary set, interior the initial guess) with
+// jacobi sweeps in the precision selected by mode: MODE_JACOBI runs in
+// double, MODE_FLOAT in float, MODE_MIXED in float with double refinement.
+// The result is left in T.  Returns the final largest change measured in
+// double; *iterations gets the number of sweeps and *bytes the size of the
+// grids the sweeps stream through.
+double precision_solve( grid_t* T, solver_t mode, int max_iterations, double tol,
+                        int* iterations, size_t* bytes ) {
+    int rows = T->rows, columns = T->columns;
+    int i, j, sweeps, which;
+
+    *iterations = 0;
+
+    if ( mode == MODE_JACOBI ) {
+        grid_t* other = grid_alloc( rows, columns );
+        grid_t* from = T;
+        grid_t* to = other;
+        int stride = T->stride;
+        double dt = HUGE_VAL;
+
+        memcpy( other->data, T->data, grid_bytes( T ) );
+        while ( dt > tol && *iterations < max_iterations ) {
+            dt = 0.0;
+            #pragma omp parallel for reduction(max:dt) schedule(static)
+            for ( i = 1; i <= rows; i++ )
+                dt = fmax( dt, jacobi_loop( i, columns, stride, to->data, from->data ) );
+
+            grid_t* tmp = from;
+            from = to;
+            to = tmp;
+            (*iterations)++;
+        }
+        if ( from != T ) memcpy( T->data, from->data, grid_bytes( T ) );
+
+        *bytes = 2 * grid_bytes( T );
+        grid_free( other );
+        return jacobi_change( T );
+    }
+
+    // The plate starts at 0 and heat diffuses in from two edges, so most of
+    // the float field passes through denormals early on; flush them to zero
+    // on every thread or the sweeps run at microcode speed.  The modes are
+    // put back on the way out so later double work is unaffected.
+    unsigned int csr = _mm_getcsr();
+    #pragma omp parallel
+    {
+        _MM_SET_FLUSH_ZERO_MODE( _MM_FLUSH_ZERO_ON );
+        _MM_SET_DENORMALS_ZERO_MODE( _MM_DENORMALS_ZERO_ON );
+    }
+
+    // float phase, shared by MODE_FLOAT and MODE_MIXED
+    plane_t* a = plane_alloc( rows, columns );
+    plane_t* b = plane_alloc( rows, columns );
+
+    plane_load( a, T );
+    plane_load( b, T );
+    double float_tol = mode == MODE_MIXED ? MIXED_LOOSEN * tol : tol;
+    relax( a, b, NULL, fmax( float_tol, FLOAT_FLOOR ), max_iterations, &sweeps, &which );
+    *iterations += sweeps;
+
+    plane_t* u = which ? b : a;
+    #pragma omp parallel for private(j) schedule(static)
+    for ( i = 1; i <= rows; i++ )
+        for ( j = 1; j <= columns; j++ )
+            GRID(T,i,j) = u->data[(size_t)i*u->stride + j];
+
+    *bytes = plane_bytes( a ) + plane_bytes( b );
+    double dt = jacobi_change( T );
+
+    if ( mode == MODE_FLOAT ) {
+        plane_free( a );
+        plane_free( b );
+        #pragma omp parallel
+        _mm_setcsr( csr );
+        return dt;
+    }
+
+    // iterative refinement: a and b now hold the correction, r the residual
+    plane_t* r = plane_alloc( rows, columns );
+    int stride = T->stride;
+    *bytes += plane_bytes( r ) + grid_bytes( T );
+
+    // at least one correction, even if the float phase happened to get there
+    do {
+        // r = sum of neighbours - 4u, in double, rounded once to float
+        #pragma omp parallel for private(j) schedule(static)
+        for ( i = 1; i <= rows; i++ ) {
+            const double* t = T->data + (size_t)i * stride;
+            float* f = r->data + (size_t)i * r->stride;
+            for ( j = 1; j <= columns; j++ )
+                f[j] = (float)( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] - 4.0 * t[j] );
+        }
+
+        memset( a->data, 0, plane_bytes( a ) );
+        memset( b->data, 0, plane_bytes( b ) );
+        relax( a, b, r, tol, max_iterations - *iterations, &sweeps, &which );
+        *iterations += sweeps;
+
+        plane_t* e = which ? b : a;
+        #pragma omp parallel for private(j) schedule(static)
+        for ( i = 1; i <= rows; i++ )
+            for ( j = 1; j <= columns; j++ )
+                GRID(T,i,j) += e->data[(size_t)i*e->stride + j];
+
+        dt = jacobi_change( T );
+    } while ( dt > tol && *iterations < max_iterations );
+
+    plane_free( r );
+    plane_free( a );
+    plane_free( b );
+    #pragma omp parallel
+    _mm_setcsr( csr );
+    return dt;
+}
+
+// largest absolute difference between the interiors of two plates
+double max_difference( const grid_t* a, const grid_t* b ) {
+    double d = 0.0;
+    int i, j;
+
+    #pragma omp parallel for private(j) reduction(max:d) schedule(static)
+    for ( i = 1; i <= a->rows; i++ )
+        for ( j = 1; j <= a->columns; j++ )
+            d = fmax( d, fabs( GRID(a,i,j) - GRID(b,i,j) ) );
+    return d;
+}
@@ -0,0 +1,120 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_thread_num() 0
+#endif
+
+#include "config.h"
+#include "grid.h"
+
+// Thread placement and page placement helpers for the NUMA experiments.
+// Topology comes from sysfs and page locations from the move_pages system
+// call, so nothing beyond libc is needed.
+
+// socket (physical package) of a cpu, -1 if sysfs does not say
+int cpu_package( int cpu ) {
+    char path[128];
+    int package = -1;
+    FILE* f;
+
+    snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu );
+    if ( (f = fopen( path, "r" )) == NULL ) return -1;
+    if ( fscanf( f, "%d", &package ) != 1 ) package = -1;
+    fclose( f );
+    return package;
+}
+
+int num_packages( void ) {
+    int ncpu = sysconf( _SC_NPROCESSORS_CONF );
+    int packages = 1;
+    int cpu;
+
+    for ( cpu = 0; cpu < ncpu; cpu++ )
+        if ( cpu_package( cpu ) + 1 > packages ) packages = cpu_package( cpu ) + 1;
+    return packages;
+}
+
+// Pin each OpenMP thread to one cpu.  compact fills a socket before moving
+// to the next, scatter deals threads round-robin across sockets.
+void pin_threads( pin_t policy ) {
+    if ( policy == PIN_NONE ) return;
+
+    int ncpu = sysconf( _SC_NPROCESSORS_CONF );
+    int packages = num_packages();
+    int* order = (int*)malloc( ncpu * sizeof(int) );
+    int n = 0, cpu, pkg;
+    cpu_set_t allowed;
+
+    sched_getaffinity( 0, sizeof(allowed), &allowed );
+
+    if ( policy == PIN_COMPACT ) {
+        for ( pkg = 0; pkg < packages; pkg++ )
+            for ( cpu = 0; cpu < ncpu; cpu++ )
+                if ( CPU_ISSET( cpu, &allowed ) && (cpu_package( cpu ) == pkg || (pkg == 0 && cpu_package( cpu ) < 0)) )
+                    order[n++] = cpu;
+    }
+    else {
+        // k-th cpu of every socket before the (k+1)-th of any
+        int* next = (int*)calloc( packages, sizeof(int) );
+        int placed = 1;
+        while ( placed ) {
+            placed = 0;
+            for ( pkg = 0; pkg < packages; pkg++ ) {
+                for ( cpu = next[pkg]; cpu < ncpu; cpu++ )
+                    if ( CPU_ISSET( cpu, &allowed ) && (cpu_package( cpu ) == pkg || (pkg == 0 && cpu_package( cpu ) < 0)) )
+                        break;
+                if ( cpu < ncpu ) {
+                    order[n++] = cpu;
+                    next[pkg] = cpu + 1;
+                    placed = 1;
+                }
+            }
+        }
+        free( next );
+    }
+
+    if ( n > 0 ) {
+        #pragma omp parallel
+        {
+            cpu_set_t mine;
+            CPU_ZERO( &mine );
+            CPU_SET( order[omp_get_thread_num() % n], &mine );
+            sched_setaffinity( 0, sizeof(mine), &mine );
+        }
+    }
+    free( order );
+}
+
+// Count the pages of [p, p+bytes) resident on each NUMA node.  Returns the
+// number of nodes seen (at most max_nodes), 0 if the kernel will not say.
+int page_nodes( const void* p, size_t bytes, long* pages, int max_nodes ) {
+    long page = sysconf( _SC_PAGESIZE );
+    unsigned long first = (unsigned long)p & ~(page - 1);
+    unsigned long count = ((unsigned long)p + bytes - first + page - 1) / page;
+    enum { CHUNK = 4096 };
+    void* addr[CHUNK];
+    int status[CHUNK];
+    int nodes = 0;
+    unsigned long done, k;
+
+    memset( pages, 0, max_nodes * sizeof(long) );
+    for ( done = 0; done < count; done += CHUNK ) {
+        unsigned long n = count - done < CHUNK ? count - done : CHUNK;
+        for ( k = 0; k < n; k++ )
+            addr[k] = (void*)(first + (done + k) * page);
+        if ( syscall( SYS_move_pages, 0, n, addr, NULL, status, 0 ) != 0 ) return 0;
+        for ( k = 0; k < n; k++ ) {
+            if ( status[k] < 0 || status[k] >= max_nodes ) continue;
+            pages[status[k]]++;
+            if ( status[k] + 1 > nodes ) nodes = status[k] + 1;
+        }
+    }
+    return nodes;
+}
@@ -0,0 +1,124 @@
+/*************************************************
+ * NUMA placement benchmark for the Laplace sweep
+ *
+ * Runs the same jacobi_loop sweeps twice: once on grids
+ * zeroed by one thread (every page on that thread's
+ * socket) and once on grids zeroed with the sweep's own
+ * static schedule.  For each it prints where the pages
+ * landed and the bandwidth achieved by the threads of
+ * each socket.
+ *
+ *   OMP_NUM_THREADS=28 ./numa-bench -r 8192 -c 8192 -P scatter
+ *
+ ************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#define omp_get_thread_num()  0
+#endif
+
+#include "config.h"
+#include "grid.h"
+
+#define MAX_NODES 64
+
+double jacobi_loop( int row, int columns, int stride, double *restrict Temp, double *restrict Temp_last );
+const char* jacobi_kernel( void );
+
+static double now( void ) {
+    struct timeval t;
+    gettimeofday( &t, NULL );
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void run( const params_t* params, int parallel_touch ) {
+    int rows = params->rows, columns = params->columns;
+    int packages = num_packages();
+    int nthreads = omp_get_max_threads();
+    double* busy = (double*)calloc( nthreads, sizeof(double) );  // seconds in the sweep loop
+    double* bytes = (double*)calloc( nthreads, sizeof(double) ); // bytes streamed
+    int* package = (int*)calloc( nthreads, sizeof(int) );
+    long pages[MAX_NODES];
+    long page = getpagesize();      // move_pages counts system pages
+    int i, s, n, nodes;
+
+    grid_first_touch( parallel_touch );
+    grid_t* T = grid_alloc( rows, columns );
+    grid_t* T_last = grid_alloc( rows, columns );
+
+    printf( "\n%s first touch, %d threads\n", parallel_touch ? "parallel" : "serial", nthreads );
+
+    nodes = page_nodes( T_last->data, grid_bytes(T_last), pages, MAX_NODES );
+    for ( n = 0; n < nodes; n++ )
+        printf( "  node %d holds %5.1f%% of the grid pages\n", n,
+                100.0 * pages[n] / ( (grid_bytes(T_last) + page - 1) / page ) );
+    if ( nodes == 0 ) printf( "  page placement not available\n" );
+
+    for ( s = 0; s < BENCH_SWEEPS; s++ ) {
+        #pragma omp parallel
+        {
+            int t = omp_get_thread_num();
+            int cpu = sched_getcpu();
+            double start = now();
+            double streamed = 0.0;  // summed locally, bytes[] shares cache lines
+
+            #pragma omp for schedule(static) nowait
+            for ( i = 1; i <= rows; i++ ) {
+                jacobi_loop( i, columns, T->stride, T->data, T_last->data );
+                streamed += 2.0 * sizeof(double) * columns;
+            }
+
+            busy[t] += now() - start;
+            bytes[t] += streamed;
+            package[t] = cpu_package( cpu ) < 0 ? 0 : cpu_package( cpu );
+        }
+
+        grid_t* tmp = T;
+        T = T_last;
+        T_last = tmp;
+    }
+
+    // a socket's bandwidth is its threads' bytes over its slowest thread's time
+    for ( n = 0; n < packages; n++ ) {
+        double b = 0.0, slowest = 0.0;
+        int members = 0;
+        for ( i = 0; i < nthreads; i++ ) {
+            if ( package[i] != n ) continue;
+            b += bytes[i];
+            slowest = fmax( slowest, busy[i] );
+            members++;
+        }
+        if ( members )
+            printf( "  socket %d: %2d threads, %7.2f GB/s\n", n, members, b / slowest / 1.0e9 );
+    }
+
+    grid_free( T );
+    grid_free( T_last );
+    free( busy );
+    free( bytes );
+    free( package );
+}
+
+int main( int argc, char *argv[] ) {
+    params_t params;
+
+    parse_params( argc, argv, &params );
+    pin_threads( params.pin );
+    jacobi_kernel();     // pick the row kernel before any thread needs it
+
+    printf( "NUMA benchmark: %dx%d plate, %d sweeps, %d sockets, pinning %s\n",
+            params.rows, params.columns, BENCH_SWEEPS, num_packages(), pin_name( params.pin ) );
+
+    run( &params, 0 );   // before: one thread touches everything
+    run( &params, 1 );   // after: pages follow the sweep schedule
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "grid.h"
+
+// relax every cell of one colour ((i+j)%2 == color) in place
+static double redblack_half( grid_t* T, int color, double omega ) {
+    int rows    = T->rows;
+    int columns = T->columns;
+    int stride  = T->stride;
+    double dt = 0.0;
+    int i, j;
+
+    #pragma omp parallel for private(j) reduction(max:dt) schedule(static)
+    for ( i = 1; i <= rows; i++ ) {
+        double* t = T->data + (size_t)i * stride;
+
+        for ( j = 1 + ((i + 1 + color) & 1); j <= columns; j += 2 ) {
+            double gs  = 0.25 * ( t[j-1] + t[j+1] + t[j-stride] + t[j+stride] );
+            double new = t[j] + omega * ( gs - t[j] );
+            dt = fmax( dt, fabs( new - t[j] ) );
+            t[j] = new;
+        }
+    }
+    return dt;
+}
+
+// One red-black Gauss-Seidel sweep (omega == 1) or SOR sweep (1 < omega < 2),
+// updating T in place.  Each colour only reads the other colour, so the rows
+// of a half sweep can be split across threads.  Returns the largest change.
+double redblack_sweep( grid_t* T, double omega ) {
+    double dt_red   = redblack_half( T, 0, omega );
+    double dt_black = redblack_half( T, 1, omega );
+    return fmax( dt_red, dt_black );
+}
+
+// omega that minimises the SOR spectral radius for the model problem
+double sor_optimal_omega( int rows, int columns ) {
+    int n = rows > columns ? rows : columns;
+    return 2.0 / ( 1.0 + sin( M_PI / (n + 1) ) );
+}
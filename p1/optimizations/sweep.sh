@@ -0,0 +1,86 @@
+#!/bin/bash
+#
+# Parameter sweep over the Laplace binaries.
+# Runs every grid x thread count x variant x iteration cap, first WARMUP
+# untimed runs and then TRIALS timed ones, and prints one CSV row per point
+# with the median and minimum "Total time", Gflops at 5 flops per cell
+# update and sweep-equivalent bandwidth, both from the median.
+#
+#   ./sweep.sh [-g "grids"] [-t "threads"] [-n "max_iterations"]
+#              [-r trials] [-w warmup] [-b bytes_per_cell] variant...
+#
+# A variant is a command line such as "./lap2-2 -m tb -k 8"; it gets
+# -r/-c for the grid and -n for the cap.  Binaries with a compiled in
+# plate are written SIZE:command, e.g. "8192:../../p2/lgpu6", get only -n
+# and are run for the matching grid alone.  Use -b 8 for float variants.
+
+GRIDS="1000"
+THREADS="1"
+CAPS="1000"
+TRIALS=5
+WARMUP=1
+BYTES=16
+
+while getopts "g:t:n:r:w:b:" OPT
+do
+    case ${OPT} in
+    g) GRIDS=${OPTARG} ;;
+    t) THREADS=${OPTARG} ;;
+    n) CAPS=${OPTARG} ;;
+    r) TRIALS=${OPTARG} ;;
+    w) WARMUP=${OPTARG} ;;
+    b) BYTES=${OPTARG} ;;
+    *) sed -n '9,10p' $0 >&2; exit 1 ;;
+    esac
+done
+shift $((OPTIND-1))
+if [ $# -eq 0 ]
+then
+    sed -n '9,10p' $0 >&2
+    exit 1
+fi
+
+echo "grid, threads, variant, max_iterations, iterations, trials, median_seconds, min_seconds, gflops, gb_per_s"
+for G in ${GRIDS}
+do
+    for T in ${THREADS}
+    do
+        for V in "$@"
+        do
+            # fixed size binaries only run at their own size
+            CMD="${V} -r ${G} -c ${G}"
+            case ${V} in
+            [0-9]*:*)
+                [ "${V%%:*}" = "${G}" ] || continue
+                CMD="${V#*:}"
+                ;;
+            esac
+
+            for N in ${CAPS}
+            do
+                for ((W = 0; W < WARMUP; W++))
+                do
+                    OMP_NUM_THREADS=${T} ${CMD} -n ${N} > /dev/null
+                done
+
+                TIMES=""
+                for ((R = 0; R < TRIALS; R++))
+                do
+                    OUT=$(OMP_NUM_THREADS=${T} ${CMD} -n ${N})
+                    TIMES="${TIMES} $(echo "${OUT}" | awk '/Total time was/ { print $4 }')"
+                    DONE=$(echo "${OUT}" | awk '/Max error at iteration/ { print $5 }')
+                done
+
+                echo ${TIMES} | tr ' ' '\n' | sort -g | awk -v g=${G} -v t=${T} -v v="${V}" \
+                    -v n=${N} -v done=${DONE} -v b=${BYTES} '
+                    { s[NR] = $1 }
+                    END {
+                        med = NR % 2 ? s[(NR+1)/2] : (s[NR/2] + s[NR/2+1]) / 2
+                        cells = g * g * done
+                        printf "%d, %d, \"%s\", %d, %d, %d, %f, %f, %.2f, %.2f\n", g, t, v, n, done,
+                               NR, med, s[1], 5 * cells / med / 1e9, b * cells / med / 1e9
+                    }'
+            done
+        done
+    done
+done
@@ -0,0 +1,316 @@
+/**
+ * @file    floyd.c
+ * @brief   Floyd-Warshall engines: the naive k-i-j loop and the three phase
+ *          blocked version.  The naive loop streams the whole matrix from
+ *          memory once per k; the blocked one splits it into tile x tile
+ *          tiles and, for each diagonal tile kb, does every k in kb while
+ *          the tiles involved sit in cache:
+ *
+ *            phase 1  the diagonal tile (kb,kb) on its own
+ *            phase 2  the rest of tile row kb and tile column kb, which
+ *                     only need the finished diagonal tile
+ *            phase 3  every other tile (ib,jb), which only needs the
+ *                     finished panel tiles (ib,kb) and (kb,jb)
+ *
+ *          Tiles within phase 2 and within phase 3 are independent and are
+ *          shared out over the OpenMP threads.
+ *
+ *          The R-Kleene engine gets the same locality without a tile size:
+ *          it splits the matrix into quadrants A B / C D and recurses,
+ *
+ *            A = A*     B = A B    C = C A    D = min(D, C B)
+ *            D = D*     B = B D    C = D C    A = min(A, B C)
+ *
+ *          with * the closure (a recursive call) and products in the
+ *          min-plus sense, each kept only where it is shorter, and split
+ *          into quadrants in turn like rec_matmul in p4/jbut/smm.c.  Every
+ *          level of the recursion fits some level of cache, whatever the
+ *          sizes are; independent quadrants become OpenMP tasks.
+ *
+ *          All three engines can maintain a next hop matrix for path
+ *          reconstruction (see path.c) in the same pass.  floyd_run also
+ *          dispatches to the sparse engine in sparse.c, which floyd_choose
+ *          picks for graphs with few edges.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "floyd.h"
+
+static const char* algo_names[ALGO_COUNT] = { "naive", "blocked", "dijkstra", "rkleene" };
+
+/**
+ * @name     relax_row
+ * @brief    d[c+j] = min(d[c+j], d[a] + b[j]) for j < cols, where c and a
+ *           are offsets into the n x n matrix.  With a next hop matrix the
+ *           cells that improve also take next[a], the hop towards column
+ *           a's vertex.
+ *
+ ******************************************************************************/
+static inline void relax_row(float* d, floyd_next_t* next, size_t c, size_t a,
+                             const float* b, int cols)
+{
+    if(next == NULL) {
+        minplus_f32(d + c, b, d[a], cols);
+    } else if(next->width == 2) {
+        short* nx = (short*)next->next;
+        minplus_f32_n16(d + c, b, d[a], nx + c, nx[a], cols);
+    } else {
+        int* nx = (int*)next->next;
+        minplus_f32_n32(d + c, b, d[a], nx + c, nx[a], cols);
+    }
+}
+
+/**
+ * @name     floyd_naive
+ * @brief    in place Floyd-Warshall, one sweep over the matrix per k;
+ *           next, if not NULL, is kept up to date alongside d
+ *
+ ******************************************************************************/
+void floyd_naive(float* d, int n, floyd_next_t* next)
+{
+    float* tmp = (float*)malloc(n * sizeof(float));
+    int i, k;
+
+    for(k = 0; k < n; k++) {
+        // row k does not change during step k, keep a copy the threads share
+        memcpy(tmp, d + (size_t)k*n, n * sizeof(float));
+
+        #pragma omp parallel for schedule(static)
+        for(i = 0; i < n; i++) {
+            relax_row(d, next, (size_t)i*n, (size_t)i*n + k, tmp, n);
+        }
+    }
+    free(tmp);
+}
+
+/**
+ * @name     tile_update
+ * @brief    d[i][j] = min(d[i][j], d[i][k] + d[k][j]) over the rows x cols
+ *           tile at (i0,j0), for the depth values of k from k0, k
+ *           outermost so it is also right when the (i,k) or (k,j) tile is
+ *           the tile itself (phases 1 and 2).
+ *
+ ******************************************************************************/
+static void tile_update(float* d, floyd_next_t* next, int n, int i0, int j0, int k0,
+                        int rows, int cols, int depth)
+{
+    int i, k;
+
+    for(k = k0; k < k0 + depth; k++) {
+        const float* bk = d + (size_t)k*n + j0;
+        for(i = i0; i < i0 + rows; i++) {
+            relax_row(d, next, (size_t)i*n + j0, (size_t)i*n + k, bk, cols);
+        }
+    }
+}
+
+/**
+ * @name     floyd_blocked
+ * @brief    in place three phase blocked Floyd-Warshall with tile x tile
+ *           tiles; n need not be a multiple of tile.  next as for
+ *           floyd_naive.
+ *
+ ******************************************************************************/
+void floyd_blocked(float* d, int n, int tile, floyd_next_t* next)
+{
+    int nt = (n + tile - 1) / tile;
+    int kb;
+
+    #pragma omp parallel private(kb)
+    for(kb = 0; kb < nt; kb++) {
+        int k0 = kb * tile;
+        int kd = MIN(tile, n - k0);
+        int t;
+
+        // phase 1: the diagonal tile
+        #pragma omp single
+        tile_update(d, next, n, k0, k0, k0, kd, kd, kd);
+
+        // phase 2: tile row kb and tile column kb, 2 (nt-1) tiles
+        #pragma omp for schedule(dynamic)
+        for(t = 0; t < 2*nt; t++) {
+            int b = t >> 1;
+            int o0 = b * tile;
+            int od = MIN(tile, n - o0);
+
+            if(b == kb) continue;
+            if(t & 1) {
+                tile_update(d, next, n, o0, k0, k0, od, kd, kd);
+            } else {
+                tile_update(d, next, n, k0, o0, k0, kd, od, kd);
+            }
+        }
+
+        // phase 3: everything else
+        #pragma omp for schedule(static)
+        for(t = 0; t < nt*nt; t++) {
+            int ib = t / nt, jb = t % nt;
+            int i0 = ib * tile, j0 = jb * tile;
+
+            if(ib == kb || jb == kb) continue;
+            tile_update(d, next, n, i0, j0, k0, MIN(tile, n - i0), MIN(tile, n - j0), kd);
+        }
+    }
+}
+
+/**
+ * @name     rk_product
+ * @brief    C = min(C, A B) in the min-plus sense, C the rows x cols block at
+ *           (ci,cj) of d, A the rows x depth block at (ci,ak) and B the
+ *           depth x cols block at (ak,cj), halving the largest of the three
+ *           sizes until the blocks are small.  B may overlap C (B = A B with
+ *           A a closure) or A may (C = C A); the update is then done in
+ *           place, which is harmless since any value already lowered is
+ *           still the length of a path and the closure covers the rest, but
+ *           the halves of C only run as separate tasks when neither reads
+ *           what the other writes.
+ *
+ ******************************************************************************/
+static void rk_product(float* d, floyd_next_t* next, int n, int ci, int cj, int ak,
+                       int rows, int cols, int depth)
+{
+    int i, k, h;
+
+    if(rows <= RKLEENE_LEAF && cols <= RKLEENE_LEAF && depth <= RKLEENE_LEAF) {
+        for(i = ci; i < ci + rows; i++) {
+            for(k = ak; k < ak + depth; k++) {
+                relax_row(d, next, (size_t)i*n + cj, (size_t)i*n + k, d + (size_t)k*n + cj, cols);
+            }
+        }
+        return;
+    }
+
+    if(depth >= rows && depth >= cols) {
+        // the two halves of the sum over k, one after the other
+        h = depth / 2;
+        rk_product(d, next, n, ci, cj, ak, rows, cols, h);
+        rk_product(d, next, n, ci, cj, ak + h, rows, cols, depth - h);
+    } else if(rows >= cols) {
+        // row halves of C read the B rows ak.., which must not be C's
+        h = rows / 2;
+        #pragma omp task if(rows > RKLEENE_TASK && (ak + depth <= ci || ci + rows <= ak))
+        rk_product(d, next, n, ci, cj, ak, h, cols, depth);
+        rk_product(d, next, n, ci + h, cj, ak, rows - h, cols, depth);
+        #pragma omp taskwait
+    } else {
+        // column halves of C read the A columns ak.., likewise
+        h = cols / 2;
+        #pragma omp task if(cols > RKLEENE_TASK && (ak + depth <= cj || cj + cols <= ak))
+        rk_product(d, next, n, ci, cj, ak, rows, h, depth);
+        rk_product(d, next, n, ci, cj + h, ak, rows, cols - h, depth);
+        #pragma omp taskwait
+    }
+}
+
+/**
+ * @name     rk_closure
+ * @brief    in place shortest paths within the size x size diagonal block at
+ *           (k0,k0), paths confined to its own vertices
+ *
+ ******************************************************************************/
+static void rk_closure(float* d, floyd_next_t* next, int n, int k0, int size)
+{
+    int h = size / 2;
+    int k1 = k0 + h, s1 = size - h;
+
+    if(size <= RKLEENE_LEAF) {
+        tile_update(d, next, n, k0, k0, k0, size, size, size);
+        return;
+    }
+
+    rk_closure(d, next, n, k0, h);
+    #pragma omp task if(size > RKLEENE_TASK)
+    rk_product(d, next, n, k0, k1, k0, h, s1, h);       // B = A B
+    rk_product(d, next, n, k1, k0, k0, s1, h, h);       // C = C A
+    #pragma omp taskwait
+    rk_product(d, next, n, k1, k1, k0, s1, s1, h);      // D = min(D, C B)
+
+    rk_closure(d, next, n, k1, s1);
+    #pragma omp task if(size > RKLEENE_TASK)
+    rk_product(d, next, n, k0, k1, k1, h, s1, s1);      // B = B D
+    rk_product(d, next, n, k1, k0, k1, s1, h, s1);      // C = D C
+    #pragma omp taskwait
+    rk_product(d, next, n, k0, k0, k1, h, h, s1);       // A = min(A, B C)
+}
+
+/**
+ * @name     floyd_rkleene
+ * @brief    in place recursive (R-Kleene) all pairs shortest paths, no tile
+ *           size to tune.  next as for floyd_naive.
+ *
+ ******************************************************************************/
+void floyd_rkleene(float* d, int n, floyd_next_t* next)
+{
+    #pragma omp parallel
+    #pragma omp single
+    rk_closure(d, next, n, 0, n);
+}
+
+/**
+ * @name     floyd_run
+ * @brief    run the selected engine in place on d (and next, if not NULL)
+ *
+ ******************************************************************************/
+void floyd_run(floyd_algo_t algo, float* d, int n, int tile, floyd_next_t* next)
+{
+    minplus_kernel();       // pick the row kernel before any thread needs it
+    switch(algo) {
+    case ALGO_BLOCKED: floyd_blocked(d, n, tile, next); break;
+    case ALGO_RKLEENE: floyd_rkleene(d, n, next); break;
+    case ALGO_DIJKSTRA: {
+        csr_t* g = csr_from_dense(d, n);
+        dijkstra_rows(g, 0, n, d, next);
+        csr_free(g);
+        break;
+    }
+    default:           floyd_naive(d, n, next); break;
+    }
+}
+
+/**
+ * @name     floyd_choose
+ * @brief    the engine for -a auto: Dijkstra when fewer than SPARSE_DENSITY
+ *           of the possible edges are there and none is negative, blocked
+ *           Floyd otherwise
+ *
+ ******************************************************************************/
+floyd_algo_t floyd_choose(const float* d, int n)
+{
+    long negative = 0;
+    int i, j;
+
+    if(graph_density(d, n) >= SPARSE_DENSITY) return ALGO_BLOCKED;
+
+    #pragma omp parallel for private(j) reduction(+:negative) schedule(static)
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < n; j++) {
+            if(d[(size_t)i*n + j] < 0) negative++;
+        }
+    }
+    return negative ? ALGO_BLOCKED : ALGO_DIJKSTRA;
+}
+
+const char* floyd_algo_name(floyd_algo_t algo)
+{
+    return algo_names[algo];
+}
+
+/**
+ * @name     floyd_algo_parse
+ * @brief    engine for a -a argument, -1 if there is none by that name
+ *
+ ******************************************************************************/
+int floyd_algo_parse(const char* name)
+{
+    int a;
+
+    for(a = 0; a < ALGO_COUNT; a++) {
+        if(strcmp(name, algo_names[a]) == 0) return a;
+    }
+    return -1;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file    floyd.h
+ * @brief   shared all pairs shortest path engines for the p3 drivers.
+ *          Distance matrices are n x n floats, row major, with FLOYD_INF
+ *          for "no edge".
+ *
+ */
+#ifndef __FLOYD_H__
+#define __FLOYD_H__
+
+#include <math.h>
+
+/* Defines */
+#define FLOYD_INF     INFINITY
+#define FLOYD_TILE    64            // default tile edge for the blocked engine
+#define RKLEENE_LEAF  64            // R-Kleene stops splitting at 64 x 64 blocks (16 KB)
+#define RKLEENE_TASK  256           // and stops making tasks here
+#define FLOYD_DIM     8192          // default problem size, as in kgill's floyd.c
+#define GRAPH_INFTY   (1 << 29)     // "no edge" in graph files, as in wjiang's genMatrix_floyd.c
+#define FLOYD_INF_I32 GRAPH_INFTY   // "no edge" in int32 matrices; twice it still fits
+#define FLOYD_INF_U16 0xffff        // and in uint16 ones
+
+/* below this edge density -a auto runs Dijkstra from every source instead
+   of Floyd; n Dijkstras cost about n^2 (1 + density n) log n against n^3 */
+#ifndef SPARSE_DENSITY
+#define SPARSE_DENSITY 0.01
+#endif
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+/* engine selected with -a */
+typedef enum {
+    ALGO_NAIVE,                     // k-i-j triple loop
+    ALGO_BLOCKED,                   // three phase tiled
+    ALGO_DIJKSTRA,                  // one Dijkstra per source on the CSR graph
+    ALGO_RKLEENE,                   // recursive quadrant closure, no tile size
+    ALGO_COUNT
+} floyd_algo_t;
+
+/* next hop matrix: next[u][v] is the vertex after u on a shortest path
+   from u to v, u itself when u == v, -1 when v cannot be reached */
+typedef struct {
+    int   n;
+    int   width;                    // bytes per index: 2 (n <= 32767) or 4
+    void* next;                     // n x n short or int
+} floyd_next_t;
+
+/* graph file layouts, see graph_io.c */
+typedef enum {
+    GRAPH_INT32,                    // int n, int n, n x n ints (genMatrix_floyd.c)
+    GRAPH_RAW32,                    // n x n float32, no header (write_mat.py)
+    GRAPH_APSP                      // versioned header, then the matrix
+} graph_format_t;
+
+typedef enum {
+    GRAPH_F32,
+    GRAPH_I32,
+    GRAPH_U16
+} graph_dtype_t;
+
+typedef struct {
+    int            n;
+    graph_format_t format;
+    graph_dtype_t  dtype;           // element type on disk
+    int            tile;            // 0 row major, else the tile edge of a tile major file
+    double         infinity;        // on disk value for "no edge", and anything above it
+    long           offset;          // bytes before the matrix
+} graph_info_t;
+
+/* sparse graph in compressed sparse row form: the edges out of u are
+   col[row[u]] .. col[row[u+1]-1] with weights w[] */
+typedef struct {
+    int    n;
+    long   m;                       // edges
+    long*  row;                     // n + 1 offsets
+    int*   col;
+    float* w;
+} csr_t;
+
+/* floyd.c; next may be NULL for distances only */
+void floyd_naive(float* d, int n, floyd_next_t* next);
+void floyd_blocked(float* d, int n, int tile, floyd_next_t* next);
+void floyd_rkleene(float* d, int n, floyd_next_t* next);
+void floyd_run(floyd_algo_t algo, float* d, int n, int tile, floyd_next_t* next);
+const char* floyd_algo_name(floyd_algo_t algo);
+int floyd_algo_parse(const char* name);
+floyd_algo_t floyd_choose(const float* d, int n);
+
+/* floyd_typed.c; integer matrices use FLOYD_INF_I32 / FLOYD_INF_U16 */
+void floyd_naive_i32(int* d, int n);
+void floyd_blocked_i32(int* d, int n, int tile);
+void floyd_naive_u16(unsigned short* d, int n);
+void floyd_blocked_u16(unsigned short* d, int n, int tile);
+int floyd_run_typed(floyd_algo_t algo, graph_dtype_t dtype, void* d, int n, int tile);
+
+/* minplus.c: c[j] = min(c[j], a + b[j]) for j < n, integer sums
+   saturating at FLOYD_INF_I32 / FLOYD_INF_U16 */
+void minplus_f32(float* c, const float* b, float a, int n);
+void minplus_i32(int* c, const int* b, int a, int n);
+void minplus_u16(unsigned short* c, const unsigned short* b, unsigned short a, int n);
+/* the same with next hop upkeep: where a + b[j] < c[j], nc[j] = nk */
+void minplus_f32_n32(float* c, const float* b, float a, int* nc, int nk, int n);
+void minplus_f32_n16(float* c, const float* b, float a, short* nc, short nk, int n);
+int minplus_select(const char* name);
+const char* minplus_kernel(void);
+
+/* path.c */
+floyd_next_t* next_create(const float* d, int n, int width);
+void next_free(floyd_next_t* next);
+size_t next_bytes(const floyd_next_t* next);
+int floyd_path(const floyd_next_t* next, int u, int v, int* path, int max);
+
+/* sparse.c; Dijkstra needs non-negative weights */
+csr_t* csr_alloc(int n, long m);
+csr_t* csr_from_dense(const float* d, int n);
+csr_t* csr_tridiagonal(int n);
+void csr_free(csr_t* g);
+double graph_density(const float* d, int n);
+void dijkstra_rows(const csr_t* g, int s0, int s1, float* out, floyd_next_t* next);
+csr_t* csr_transpose(const csr_t* g);
+void dijkstra_repair(const csr_t* g, const csr_t* gt, int s, float* row, const char* stale);
+
+/* incremental.c; g holds the edge weights d was solved from */
+int apsp_decrease(float* g, float* d, int n, int u, int v, float w);
+int apsp_increase(float* g, float* d, int n, int u, int v, float w);
+int apsp_update(float* g, float* d, int n, int u, int v, float w);
+
+/* graph.c */
+float* graph_tridiagonal(int n);
+int graph_check_tridiagonal(const float* d, int n);
+float* graph_components(int n, int parts, int degree, int maxw, int skew, unsigned seed);
+
+/* graph_io.c */
+int graph_layout(const char* spec, graph_info_t* info);
+int graph_dtype_parse(const char* name);
+size_t graph_dtype_size(graph_dtype_t dtype);
+size_t graph_index(const graph_info_t* info, int i, int j);
+int graph_probe(const char* path, graph_info_t* info);
+void graph_decode(const void* in, float* out, size_t count, const graph_info_t* info);
+long graph_encode(const float* in, void* out, size_t count, const graph_info_t* info);
+int graph_header(const graph_info_t* info, void* buf);
+float* graph_read(const char* path, int* n);
+int graph_write(const char* path, const float* d, int n, const graph_info_t* layout);
+
+#endif
@@ -0,0 +1,355 @@
+/**
+ * @file    floyd_mpi.c
+ * @brief   MPI Floyd driver, rows striped over the ranks in blocks as in
+ *          Quinn's code.  Every k needs row k on every rank:
+ *
+ *            -a bcast     the owner copies row k and everyone waits in a
+ *                         blocking MPI_Bcast before updating, as
+ *                         sjosh's mpi_floyd.c and jbut's floyd.c do
+ *            -a pipeline  one row of lookahead: while row k is applied,
+ *                         the owner of row k+1 has already brought that
+ *                         row up to date (it only needs row k) and its
+ *                         MPI_Ibcast is in flight, so the broadcast is
+ *                         overlapped with the bulk of the row k update
+ *            -a checkerboard
+ *                         2D blocks on a Cartesian process grid; the
+ *                         segment of row k goes down each process column
+ *                         and the segment of column k along each process
+ *                         row, O(n/sqrt(p)) words per rank per k instead
+ *                         of n
+ *            -a dijkstra  one Dijkstra per source (sparse.c) for the rows
+ *                         this rank owns, against its own CSR copy of the
+ *                         graph; no communication at all
+ *
+ *          -a auto (the default) takes dijkstra when the test graph's edge
+ *          density is under SPARSE_DENSITY and pipeline otherwise.
+ *
+ *          Solves the tridiagonal test graph, checks the result and prints
+ *          "n, etime, flops, procs" from rank 0, flops being 2 n^3 whichever
+ *          engine ran.  -i loads a graph file of any format graph_io.c
+ *          reads instead (no check) and -o writes the solved matrix in the
+ *          -f layout (int by default), both with the collective MPI-IO of
+ *          graph_mpi.c; the load and store rates go to stderr.
+ *
+ *          usage: mpirun -n p floyd-mpi [-n dim] [-i infile] [-o outfile]
+ *                                       [-f int|raw|apsp[:f32|i32|u16][:tile]]
+ *                                       [-a auto|bcast|pipeline|checkerboard|dijkstra]
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mpi.h>
+
+#include "graph_mpi.h"
+
+/* Defines */
+#define BLOCK_LOW(id,p,n)   ((int)((long)(id)*(n)/(p)))
+#define BLOCK_SIZE(id,p,n)  (BLOCK_LOW((id)+1,p,n)-BLOCK_LOW(id,p,n))
+#define BLOCK_OWNER(k,p,n)  ((int)(((long)(p)*((k)+1)-1)/(n)))
+#define POLL_ROWS           32      // rows updated between MPI_Test calls
+
+typedef enum { AUTO, BCAST, PIPELINE, CHECKERBOARD, DIJKSTRA } mpi_algo_t;
+
+static const char* mpi_algo_names[] = { "auto", "bcast", "pipeline", "checkerboard", "dijkstra" };
+
+/**
+ * @name     floyd_bcast
+ * @brief    a blocking broadcast of row k before every k
+ * @param
+ *       @name   a
+ *       @dir    I/O
+ *       @type   float*
+ *       @brief  this rank's rows, rows x n, global rows low .. low+rows-1
+ *
+ ******************************************************************************/
+static void floyd_bcast(float* a, int n, int low, int rows, int id, int p)
+{
+    float* tmp = (float*)malloc(n * sizeof(float));
+    int i, k;
+
+    for(k = 0; k < n; k++) {
+        int root = BLOCK_OWNER(k, p, n);
+
+        if(root == id) {
+            memcpy(tmp, a + (size_t)(k - low)*n, n * sizeof(float));
+        }
+        MPI_Bcast(tmp, n, MPI_FLOAT, root, MPI_COMM_WORLD);
+        for(i = 0; i < rows; i++) {
+            minplus_f32(a + (size_t)i*n, tmp, a[(size_t)i*n + k], n);
+        }
+    }
+    free(tmp);
+}
+
+/**
+ * @name     floyd_pipeline
+ * @brief    lookahead broadcast: row k+1 is updated and sent first, then
+ *           row k is applied to the other rows while it travels.  Two row
+ *           buffers alternate; every rank posts the broadcasts in k order.
+ *
+ ******************************************************************************/
+static void floyd_pipeline(float* a, int n, int low, int rows, int id, int p)
+{
+    float* buf[2];
+    MPI_Request req[2];
+    int i, k, flag;
+
+    buf[0] = (float*)malloc(n * sizeof(float));
+    buf[1] = (float*)malloc(n * sizeof(float));
+
+    if(BLOCK_OWNER(0, p, n) == id) {
+        memcpy(buf[0], a, n * sizeof(float));
+    }
+    MPI_Ibcast(buf[0], n, MPI_FLOAT, BLOCK_OWNER(0, p, n), MPI_COMM_WORLD, &req[0]);
+
+    for(k = 0; k < n; k++) {
+        float* rowk = buf[k & 1];
+        int ahead = -1;                 // local index of row k+1 if it is ours
+
+        MPI_Wait(&req[k & 1], MPI_STATUS_IGNORE);
+
+        if(k + 1 < n) {
+            int root = BLOCK_OWNER(k + 1, p, n);
+            float* next = buf[(k + 1) & 1];
+
+            if(root == id) {
+                ahead = k + 1 - low;
+                minplus_f32(a + (size_t)ahead*n, rowk, a[(size_t)ahead*n + k], n);
+                memcpy(next, a + (size_t)ahead*n, n * sizeof(float));
+            }
+            MPI_Ibcast(next, n, MPI_FLOAT, root, MPI_COMM_WORLD, &req[(k + 1) & 1]);
+        }
+
+        for(i = 0; i < rows; i++) {
+            if(i != ahead) {
+                minplus_f32(a + (size_t)i*n, rowk, a[(size_t)i*n + k], n);
+            }
+            // give the library a chance to move the next row along
+            if(k + 1 < n && i % POLL_ROWS == POLL_ROWS - 1) {
+                MPI_Test(&req[(k + 1) & 1], &flag, MPI_STATUS_IGNORE);
+            }
+        }
+    }
+    free(buf[0]);
+    free(buf[1]);
+}
+
+/**
+ * @name     floyd_checkerboard
+ * @brief    Floyd on a 2D block of the matrix
+ * @param
+ *       @name   a
+ *       @dir    I/O
+ *       @type   float*
+ *       @brief  this rank's block, rows x cols, global top left (low, left)
+ * @param
+ *       @name   row_comm, col_comm
+ *       @dir    I
+ *       @type   MPI_Comm
+ *       @brief  the ranks of this process row / column, ranked by grid
+ *               column / row
+ *
+ ******************************************************************************/
+static void floyd_checkerboard(float* a, int n, int low, int rows, int left, int cols,
+                               int grid[2], int coords[2], MPI_Comm row_comm, MPI_Comm col_comm)
+{
+    float* rowk = (float*)malloc(cols * sizeof(float));
+    float* colk = (float*)malloc(rows * sizeof(float));
+    int i, k;
+
+    for(k = 0; k < n; k++) {
+        int row_root = BLOCK_OWNER(k, grid[0], n);     // grid row holding row k
+        int col_root = BLOCK_OWNER(k, grid[1], n);     // grid column holding column k
+
+        if(coords[0] == row_root) {
+            memcpy(rowk, a + (size_t)(k - low)*cols, cols * sizeof(float));
+        }
+        if(coords[1] == col_root) {
+            for(i = 0; i < rows; i++) {
+                colk[i] = a[(size_t)i*cols + k - left];
+            }
+        }
+        MPI_Bcast(rowk, cols, MPI_FLOAT, row_root, col_comm);
+        MPI_Bcast(colk, rows, MPI_FLOAT, col_root, row_comm);
+
+        for(i = 0; i < rows; i++) {
+            minplus_f32(a + (size_t)i*cols, rowk, colk[i], cols);
+        }
+    }
+    free(rowk);
+    free(colk);
+}
+
+/**
+ * @name     block_density
+ * @brief    edge density of the whole graph from the ranks' blocks, or 1
+ *           if any weight is negative, which rules Dijkstra out
+ *
+ ******************************************************************************/
+static double block_density(const float* a, int n, int low, int rows, int left, int cols)
+{
+    long count[2] = { 0, 0 }, total[2];      // edges, negative weights
+    int i, j;
+
+    for(i = 0; i < rows; i++) {
+        for(j = 0; j < cols; j++) {
+            float x = a[(size_t)i*cols + j];
+            if(low + i != left + j && x < FLOYD_INF) count[0]++;
+            if(x < 0) count[1]++;
+        }
+    }
+    MPI_Allreduce(count, total, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    return total[1] ? 1.0 : (double)total[0] / ((double)n * (n - 1));
+}
+
+static void usage(const char* prog, int id)
+{
+    if(!id) fprintf(stderr, "usage: %s [-n dim] [-i infile] [-o outfile]\n"
+                            "       [-f int|raw|apsp[:f32|i32|u16][:tile]]\n"
+                            "       [-a auto|bcast|pipeline|checkerboard|dijkstra]\n", prog);
+    MPI_Finalize();
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int id, p, i, j, opt;
+    int n = FLOYD_DIM;
+    mpi_algo_t algo = AUTO;
+    char* infile = NULL;
+    char* outfile = NULL;
+    graph_info_t info, layout;
+    graph_io_t io;
+    double etime, flops;
+    int error = 0, errors;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    graph_layout("int", &layout);
+    while((opt = getopt(argc, argv, "n:a:i:o:f:")) != -1) {
+        switch(opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'i': infile = optarg; break;
+        case 'o': outfile = optarg; break;
+        case 'f': if(graph_layout(optarg, &layout)) usage(argv[0], id); break;
+        case 'a':
+            for(i = DIJKSTRA; i >= AUTO; i--) {
+                if(strcmp(optarg, mpi_algo_names[i]) == 0) break;
+            }
+            if(i < AUTO) usage(argv[0], id);
+            algo = (mpi_algo_t)i;
+            break;
+        default:  usage(argv[0], id);
+        }
+    }
+    if(infile) {
+        if(graph_probe_mpi(infile, MPI_COMM_WORLD, &info)) {
+            MPI_Finalize();
+            return 1;
+        }
+        n = info.n;
+    }
+    if(n < p) usage(argv[0], id);
+
+    // 1D: a p x 1 grid of full rows; 2D: the squarest grid MPI offers
+    int grid[2] = { p, 1 }, periods[2] = { 0, 0 }, coords[2] = { id, 0 };
+    int keep_cols[2] = { 0, 1 }, keep_rows[2] = { 1, 0 };
+    MPI_Comm cart, row_comm = MPI_COMM_NULL, col_comm = MPI_COMM_NULL;
+
+    if(algo == CHECKERBOARD) {
+        grid[0] = grid[1] = 0;
+        MPI_Dims_create(p, 2, grid);
+        MPI_Cart_create(MPI_COMM_WORLD, 2, grid, periods, 1, &cart);
+        MPI_Comm_rank(cart, &id);
+        MPI_Cart_coords(cart, id, 2, coords);
+        MPI_Cart_sub(cart, keep_cols, &row_comm);
+        MPI_Cart_sub(cart, keep_rows, &col_comm);
+    }
+
+    // this rank's block of the graph file or of the tridiagonal test graph
+    int low = BLOCK_LOW(coords[0], grid[0], n);
+    int rows = BLOCK_SIZE(coords[0], grid[0], n);
+    int left = BLOCK_LOW(coords[1], grid[1], n);
+    int cols = BLOCK_SIZE(coords[1], grid[1], n);
+    float* a = (float*)malloc((size_t)rows * cols * sizeof(float));
+    if(infile) {
+        if(graph_read_block(infile, MPI_COMM_WORLD, &info, low, rows, left, cols, a, &io)) {
+            MPI_Finalize();
+            return 1;
+        }
+        if(!id) fprintf(stderr, "load: %.3f GB in %f s, %.2f GB/s\n",
+                        io.bytes / 1e9, io.seconds, io.bytes / io.seconds / 1e9);
+    } else {
+        for(i = 0; i < rows; i++) {
+            for(j = 0; j < cols; j++) {
+                int d = abs(low + i - (left + j));
+                a[(size_t)i*cols + j] = d == 0 ? 0 : d == 1 ? 1 : FLOYD_INF;
+            }
+        }
+    }
+    if(algo == AUTO) {
+        // auto is always 1D, so the grid above fits either choice
+        double density = block_density(a, n, low, rows, left, cols);
+        algo = density < SPARSE_DENSITY ? DIJKSTRA : PIPELINE;
+        if(!id) fprintf(stderr, "auto: density %g, using %s\n", density, mpi_algo_names[algo]);
+    }
+    minplus_kernel();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    etime = -MPI_Wtime();
+    if(algo == CHECKERBOARD) {
+        floyd_checkerboard(a, n, low, rows, left, cols, grid, coords, row_comm, col_comm);
+    } else if(algo == DIJKSTRA) {
+        csr_t* g = infile ? csr_gather(a, n, low, rows, MPI_COMM_WORLD) : csr_tridiagonal(n);
+        dijkstra_rows(g, low, low + rows, a, NULL);
+        csr_free(g);
+    } else if(algo == PIPELINE) {
+        floyd_pipeline(a, n, low, rows, id, p);
+    } else {
+        floyd_bcast(a, n, low, rows, id, p);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    etime += MPI_Wtime();
+
+    // Check the output of the matrix
+    for(i = 0; i < rows && !error && !infile; i++) {
+        for(j = 0; j < cols; j++) {
+            if(a[(size_t)i*cols + j] != (float)abs(low + i - (left + j))) {
+                printf("Array error! i = %d j= %d array[i][j] = %f\n", low + i, left + j,
+                       a[(size_t)i*cols + j]);
+                error = 1;
+                break;
+            }
+        }
+    }
+    MPI_Allreduce(&error, &errors, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    if(outfile) {
+        if(graph_write_block(outfile, MPI_COMM_WORLD, n, &layout, low, rows, left, cols, a, &io)) {
+            errors++;
+        } else if(!id) {
+            fprintf(stderr, "store: %.3f GB in %f s, %.2f GB/s\n",
+                    io.bytes / 1e9, io.seconds, io.bytes / io.seconds / 1e9);
+        }
+    }
+
+    flops = ((double)2 * (double)n * (double)n * (double)n)/etime;
+    if(!id && !errors) {
+        printf("%d, %f, %f, %d\n", n, etime, flops, p);
+    }
+
+    if(algo == CHECKERBOARD) {
+        MPI_Comm_free(&row_comm);
+        MPI_Comm_free(&col_comm);
+        MPI_Comm_free(&cart);
+    }
+    free(a);
+    MPI_Finalize();
+    return errors ? 1 : 0;
+}
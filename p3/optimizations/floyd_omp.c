@@ -0,0 +1,289 @@
+/**
+ * @file    floyd_omp.c
+ * @brief   OpenMP Floyd driver.  Solves the tridiagonal test graph with the
+ *          engine chosen by -a, checks the result and prints
+ *          "n, etime, flops, threads" like kgill's floyd.c, with flops
+ *          counted as 2 n^3 per solve whichever engine ran, so the sparse
+ *          engine shows up as an equivalent Floyd rate.
+ *
+ *          -a auto (the default) runs Dijkstra from every source when the
+ *          graph is sparse and blocked Floyd otherwise; the engine picked
+ *          goes to stderr.  -i reads the graph from a file in the format
+ *          of graph_io.c instead (and skips the check) and -o writes the
+ *          solved matrix out in the -f layout, the int format of wjiang's
+ *          genMatrix_floyd.c by default.
+ *
+ *          With -p 16 or -p 32 a next hop matrix with int16 or int32
+ *          indices is kept as well, a sample of the reconstructed paths is
+ *          checked and the matrix size goes to stderr, leaving stdout the
+ *          same CSV line.
+ *
+ *          -t i32 or -t u16 solves in that element type with the
+ *          saturating engines of floyd_typed.c instead of in float; the
+ *          matrix is converted before the clock starts and back after it
+ *          stops.  -V runs the self check instead: small random graphs in
+ *          several disconnected pieces, with and without negative edges
+ *          and with distances past the uint16 range, through every engine,
+ *          element type and row kernel, against float naive Floyd.
+ *
+ *          usage: floyd-omp [-n dim] [-a auto|naive|blocked|dijkstra|rkleene] [-b tile]
+ *                           [-t f32|i32|u16] [-p 16|32] [-i infile] [-o outfile]
+ *                           [-f int|raw|apsp[:f32|i32|u16][:tile]]
+ *                 floyd-omp -V
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "floyd.h"
+
+/**
+ * @name     check_paths
+ * @brief    on the tridiagonal graph the path from u to v is u, u+-1, ..., v;
+ *           check it for every v of a spread of sources u
+ * @returns  number of paths checked, -1 after reporting the first bad one
+ *
+ ******************************************************************************/
+static long check_paths(const floyd_next_t* next, int n)
+{
+    int* path = (int*)malloc(n * sizeof(int));
+    long checked = 0;
+    int u, v, i;
+
+    for(u = 0; u < n; u += MAX(1, n / 64)) {
+        for(v = 0; v < n; v++) {
+            int len = floyd_path(next, u, v, path, n);
+            int step = v > u ? 1 : -1;
+
+            if(len != abs(u - v) + 1) {
+                printf("Path error! u = %d v = %d length = %d\n", u, v, len);
+                free(path);
+                return -1;
+            }
+            for(i = 0; i < len; i++) {
+                if(path[i] != u + i * step) {
+                    printf("Path error! u = %d v = %d hop %d = %d\n", u, v, i, path[i]);
+                    free(path);
+                    return -1;
+                }
+            }
+            checked++;
+        }
+    }
+    free(path);
+    return checked;
+}
+
+/* element i of a matrix of dtype, as stored */
+static double element(const void* m, size_t i, graph_dtype_t dtype)
+{
+    // not one ?: chain, which would take the int through float
+    if(dtype == GRAPH_U16) return ((const unsigned short*)m)[i];
+    if(dtype == GRAPH_I32) return ((const int*)m)[i];
+    return ((const float*)m)[i];
+}
+
+/**
+ * @name     validate
+ * @brief    the -V self check
+ * @returns  number of failed cases, each reported on stderr
+ *
+ ******************************************************************************/
+static int validate(void)
+{
+    static const char* kernels[] = { "scalar", "avx2", "avx512" };
+    static const char* types[] = { "f32", "i32", "u16" };
+    static const int sizes[] = { 1, 2, 31, 130, 257 };
+    static const struct { int parts, degree, maxw, skew; } shapes[] = {
+        { 1,       4, 9,     0 },       // connected
+        { 3,       3, 9,     0 },       // three pieces
+        { 1 << 30, 0, 1,     0 },       // no edges at all
+        { 4,       3, 9,     6 },       // negative edges beside unreachable pairs
+        { 2,       2, 30000, 0 },       // distances past 65534, no path in uint16
+    };
+    static const struct { floyd_algo_t algo; int tile; } engines[] = {
+        { ALGO_NAIVE, 0 }, { ALGO_BLOCKED, 7 }, { ALGO_BLOCKED, 64 }, { ALGO_DIJKSTRA, 0 },
+        { ALGO_RKLEENE, 0 },
+    };
+    int z, g, t, e, v, cases = 0, failed = 0;
+
+    for(z = 0; z < (int)(sizeof(sizes) / sizeof(sizes[0])); z++) {
+        for(g = 0; g < (int)(sizeof(shapes) / sizeof(shapes[0])); g++) {
+            int n = sizes[z];
+            size_t nn = (size_t)n * n;
+            float* d = graph_components(n, shapes[g].parts, shapes[g].degree,
+                                        shapes[g].maxw, shapes[g].skew, 1 + z * 16 + g);
+            float* ref = (float*)malloc(nn * sizeof(float));
+            float* want = (float*)malloc(nn * sizeof(float));
+            float* got = (float*)malloc(nn * sizeof(float));
+
+            memcpy(ref, d, nn * sizeof(float));
+            minplus_select("scalar");
+            floyd_naive(ref, n, NULL);
+
+            for(t = GRAPH_F32; t <= GRAPH_U16; t++) {
+                graph_info_t layout;
+                char spec[16];
+
+                if(t == GRAPH_U16 && shapes[g].skew) continue;
+                snprintf(spec, sizeof(spec), "apsp:%s", types[t]);
+                graph_layout(spec, &layout);
+                graph_encode(ref, want, nn, &layout);
+
+                for(e = 0; e < (int)(sizeof(engines) / sizeof(engines[0])); e++) {
+                    if(engines[e].algo == ALGO_DIJKSTRA && (t != GRAPH_F32 || shapes[g].skew)) continue;
+                    if(engines[e].algo == ALGO_RKLEENE && t != GRAPH_F32) continue;
+                    for(v = 0; v < 3; v++) {
+                        size_t bad;
+
+                        if(minplus_select(kernels[v]) != 0) continue;
+                        graph_encode(d, got, nn, &layout);
+                        floyd_run_typed(engines[e].algo, t, got, n, MAX(engines[e].tile, 1));
+
+                        cases++;
+                        for(bad = 0; bad < nn; bad++) {
+                            if(memcmp((char*)got + bad * graph_dtype_size(t),
+                                      (char*)want + bad * graph_dtype_size(t), graph_dtype_size(t))) break;
+                        }
+                        if(bad < nn) {
+                            fprintf(stderr, "validate: n %d shape %d %s %s tile %d %s: d[%zu][%zu] = %.0f, not %.0f\n",
+                                    n, g, types[t], floyd_algo_name(engines[e].algo), engines[e].tile,
+                                    kernels[v], bad / n, bad % n, element(got, bad, t), element(want, bad, t));
+                            failed++;
+                        }
+                    }
+                }
+            }
+            free(d);
+            free(ref);
+            free(want);
+            free(got);
+        }
+    }
+    fprintf(stderr, "validate: %d of %d cases passed\n", cases - failed, cases);
+    return failed;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-n dim] [-a auto|naive|blocked|dijkstra|rkleene] [-b tile]\n"
+                    "       [-t f32|i32|u16] [-p 16|32] [-i infile] [-o outfile]\n"
+                    "       [-f int|raw|apsp[:f32|i32|u16][:tile]]\n"
+                    "       %s -V\n", prog, prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct timeval start_time, stop_time, elapsed_time;
+    double etime, flops;
+    int n = FLOYD_DIM;
+    int tile = FLOYD_TILE;
+    int algo = -1;                  // auto
+    int threads = 1;
+    int width = 0;
+    floyd_next_t* next = NULL;
+    char* infile = NULL;
+    char* outfile = NULL;
+    graph_info_t layout, typed;
+    void* buf = NULL;
+    float* d;
+    int opt;
+
+    graph_layout("int", &layout);
+    graph_layout("apsp:f32", &typed);
+    while((opt = getopt(argc, argv, "n:a:b:t:p:i:o:f:V")) != -1) {
+        switch(opt) {
+        case 'V': return validate() ? 1 : 0;
+        case 't': {
+            char spec[16];
+            snprintf(spec, sizeof(spec), "apsp:%s", optarg);
+            if(graph_dtype_parse(optarg) < 0 || graph_layout(spec, &typed)) usage(argv[0]);
+            break;
+        }
+        case 'n': n = atoi(optarg); break;
+        case 'p': width = atoi(optarg) / 8; break;
+        case 'b': tile = atoi(optarg); break;
+        case 'i': infile = optarg; break;
+        case 'o': outfile = optarg; break;
+        case 'f': if(graph_layout(optarg, &layout)) usage(argv[0]); break;
+        case 'a':
+            if(strcmp(optarg, "auto") == 0) {
+                algo = -1;
+            } else if((algo = floyd_algo_parse(optarg)) < 0) {
+                usage(argv[0]);
+            }
+            break;
+        default:  usage(argv[0]);
+        }
+    }
+    if(n < 1 || tile < 1 || (width != 0 && width != 2 && width != 4)) usage(argv[0]);
+    if(typed.dtype != GRAPH_F32 && (width || algo == ALGO_DIJKSTRA || algo == ALGO_RKLEENE)) usage(argv[0]);
+
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    if(infile) {
+        if((d = graph_read(infile, &n)) == NULL) return 1;
+    } else {
+        d = graph_tridiagonal(n);
+    }
+    if(algo < 0) {
+        algo = floyd_choose(d, n);
+        if(typed.dtype != GRAPH_F32) algo = ALGO_BLOCKED;      // no integer Dijkstra
+        fprintf(stderr, "auto: density %g, using %s\n", graph_density(d, n), floyd_algo_name(algo));
+    }
+    if(width) next = next_create(d, n, width);
+    if(typed.dtype != GRAPH_F32) {
+        long lossy;
+
+        buf = malloc((size_t)n * n * graph_dtype_size(typed.dtype));
+        if((lossy = graph_encode(d, buf, (size_t)n * n, &typed)) != 0) {
+            fprintf(stderr, "%ld weights rounded or clamped to fit -t\n", lossy);
+        }
+    }
+
+    gettimeofday(&start_time, NULL);
+    if(buf) {
+        floyd_run_typed(algo, typed.dtype, buf, n, tile);
+    } else {
+        floyd_run(algo, d, n, tile, next);
+    }
+    gettimeofday(&stop_time, NULL);
+    timersub(&stop_time, &start_time, &elapsed_time);
+    etime = elapsed_time.tv_sec+elapsed_time.tv_usec/1000000.0;
+
+    if(buf) {
+        graph_decode(buf, d, (size_t)n * n, &typed);
+        free(buf);
+    }
+
+    if(outfile && graph_write(outfile, d, n, &layout)) {
+        return 1;
+    }
+    if(!infile && graph_check_tridiagonal(d, n)) {
+        return 1;
+    }
+    if(next && !infile) {
+        long checked = check_paths(next, n);
+        if(checked < 0) return 1;
+        fprintf(stderr, "next hop int%d: %.1f MB (+%.0f%% over distances), %ld paths checked\n",
+                8 * width, next_bytes(next) / 1e6, 100.0 * width / sizeof(float), checked);
+    }
+    if(next) next_free(next);
+
+    flops = ((double)2 * (double)n * (double)n * (double)n)/etime;
+    printf("%d, %f, %f, %d\n", n, etime, flops, threads);
+
+    free(d);
+    return 0;
+}
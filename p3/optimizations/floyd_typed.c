@@ -0,0 +1,53 @@
+/**
+ * @file    floyd_typed.c
+ * @brief   Floyd-Warshall on int32 and uint16 matrices, with "no edge" as
+ *          FLOYD_INF_I32 / FLOYD_INF_U16 and the saturating row kernels of
+ *          minplus.c, so disconnected graphs and negative edges next to
+ *          unreachable vertices come out right.  uint16 halves the
+ *          matrix and doubles the SIMD lanes for graphs whose distances
+ *          fit in 16 bits.  The engines are floyd.c's, stamped out per
+ *          type from floyd_typed.h; float stays with floyd.c.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "floyd.h"
+
+#define T       int
+#define SFX(x)  x##_i32
+#define ROW     minplus_i32
+#include "floyd_typed.h"
+
+#define T       unsigned short
+#define SFX(x)  x##_u16
+#define ROW     minplus_u16
+#include "floyd_typed.h"
+
+/**
+ * @name     floyd_run_typed
+ * @brief    run the selected engine in place on an n x n matrix of dtype
+ * @returns  0, or -1 if the engine has no version for dtype
+ *
+ ******************************************************************************/
+int floyd_run_typed(floyd_algo_t algo, graph_dtype_t dtype, void* d, int n, int tile)
+{
+    if(dtype == GRAPH_F32) {
+        floyd_run(algo, (float*)d, n, tile, NULL);
+        return 0;
+    }
+    if(algo != ALGO_NAIVE && algo != ALGO_BLOCKED) return -1;
+
+    minplus_kernel();
+    if(dtype == GRAPH_I32) {
+        if(algo == ALGO_BLOCKED) floyd_blocked_i32((int*)d, n, tile);
+        else                     floyd_naive_i32((int*)d, n);
+    } else {
+        if(algo == ALGO_BLOCKED) floyd_blocked_u16((unsigned short*)d, n, tile);
+        else                     floyd_naive_u16((unsigned short*)d, n);
+    }
+    return 0;
+}
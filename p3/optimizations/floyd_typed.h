@@ -0,0 +1,84 @@
+/**
+ * @file    floyd_typed.h
+ * @brief   the naive and blocked engines of floyd.c for one integer
+ *          element type, without next hops.  Not a normal header:
+ *          floyd_typed.c includes it once per type with
+ *
+ *            T       the element type
+ *            SFX(x)  x with the type's suffix pasted on
+ *            ROW     its min-plus row kernel from minplus.c
+ *
+ *          defined, and it undefines them again.
+ *
+ */
+
+static void SFX(tile_update)(T* d, int n, int i0, int j0, int k0, int rows, int cols, int depth)
+{
+    int i, k;
+
+    for(k = k0; k < k0 + depth; k++) {
+        const T* bk = d + (size_t)k*n + j0;
+        for(i = i0; i < i0 + rows; i++) {
+            ROW(d + (size_t)i*n + j0, bk, d[(size_t)i*n + k], cols);
+        }
+    }
+}
+
+void SFX(floyd_naive)(T* d, int n)
+{
+    T* tmp = (T*)malloc(n * sizeof(T));
+    int i, k;
+
+    for(k = 0; k < n; k++) {
+        memcpy(tmp, d + (size_t)k*n, n * sizeof(T));
+
+        #pragma omp parallel for schedule(static)
+        for(i = 0; i < n; i++) {
+            ROW(d + (size_t)i*n, tmp, d[(size_t)i*n + k], n);
+        }
+    }
+    free(tmp);
+}
+
+void SFX(floyd_blocked)(T* d, int n, int tile)
+{
+    int nt = (n + tile - 1) / tile;
+    int kb;
+
+    #pragma omp parallel private(kb)
+    for(kb = 0; kb < nt; kb++) {
+        int k0 = kb * tile;
+        int kd = MIN(tile, n - k0);
+        int t;
+
+        #pragma omp single
+        SFX(tile_update)(d, n, k0, k0, k0, kd, kd, kd);
+
+        #pragma omp for schedule(dynamic)
+        for(t = 0; t < 2*nt; t++) {
+            int b = t >> 1;
+            int o0 = b * tile;
+            int od = MIN(tile, n - o0);
+
+            if(b == kb) continue;
+            if(t & 1) {
+                SFX(tile_update)(d, n, o0, k0, k0, od, kd, kd);
+            } else {
+                SFX(tile_update)(d, n, k0, o0, k0, kd, od, kd);
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for(t = 0; t < nt*nt; t++) {
+            int ib = t / nt, jb = t % nt;
+            int i0 = ib * tile, j0 = jb * tile;
+
+            if(ib == kb || jb == kb) continue;
+            SFX(tile_update)(d, n, i0, j0, k0, MIN(tile, n - i0), MIN(tile, n - j0), kd);
+        }
+    }
+}
+
+#undef T
+#undef SFX
+#undef ROW
@@ -0,0 +1,105 @@
+/**
+ * @file    graph.c
+ * @brief   test graphs for the Floyd drivers
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "floyd.h"
+
+/**
+ * @name     graph_tridiagonal
+ * @brief    the path graph 0 - 1 - ... - n-1 with unit edges, the test
+ *           kgill's floyd.c uses; every shortest path is |i-j| long
+ *
+ ******************************************************************************/
+float* graph_tridiagonal(int n)
+{
+    float* d = (float*)malloc((size_t)n * n * sizeof(float));
+    int i, j;
+
+    if(d == NULL) {
+        fprintf(stderr, "graph_tridiagonal: out of memory\n");
+        exit(1);
+    }
+
+    #pragma omp parallel for private(j) schedule(static)
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < n; j++) {
+            if(i == j) {
+                d[(size_t)i*n + j] = 0;
+            } else if(abs(i-j) == 1) {
+                d[(size_t)i*n + j] = 1;
+            } else {
+                d[(size_t)i*n + j] = FLOYD_INF;
+            }
+        }
+    }
+    return d;
+}
+
+/**
+ * @name     graph_check_tridiagonal
+ * @brief    check a solved tridiagonal graph
+ * @returns  0 if every d[i][j] == |i-j|, 1 after reporting the first error
+ *
+ ******************************************************************************/
+int graph_check_tridiagonal(const float* d, int n)
+{
+    int i, j;
+
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < n; j++) {
+            if(d[(size_t)i*n + j] != (float)abs(i-j)) {
+                printf("Array error! i = %d j= %d array[i][j] = %f\n", i, j, d[(size_t)i*n + j]);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @name     graph_components
+ * @brief    a random directed graph in parts disconnected pieces, vertex v
+ *           in piece v % parts, each vertex with degree edges to random
+ *           vertices of its own piece, weights 1 .. maxw.  With skew > 0
+ *           each vertex also gets a random potential p[v] < skew and
+ *           every edge u -> v the weight w + p[u] - p[v], which makes some
+ *           edges negative but leaves every cycle at its old positive
+ *           length, so there are no negative cycles.
+ *
+ ******************************************************************************/
+float* graph_components(int n, int parts, int degree, int maxw, int skew, unsigned seed)
+{
+    float* d = (float*)malloc((size_t)n * n * sizeof(float));
+    int* p = (int*)malloc(n * sizeof(int));
+    int u, v, e;
+
+    if(d == NULL || p == NULL) {
+        fprintf(stderr, "graph_components: out of memory\n");
+        exit(1);
+    }
+    for(u = 0; u < n; u++) {
+        p[u] = skew > 0 ? rand_r(&seed) % skew : 0;
+        for(v = 0; v < n; v++) {
+            d[(size_t)u*n + v] = u == v ? 0 : FLOYD_INF;
+        }
+    }
+    for(u = 0; u < n; u++) {
+        int piece = u % parts;
+        int size = (n - piece + parts - 1) / parts;      // vertices in u's piece
+
+        for(e = 0; e < degree && size > 1; e++) {
+            v = (rand_r(&seed) % size) * parts + piece;
+            if(v != u) {
+                d[(size_t)u*n + v] = 1 + rand_r(&seed) % maxw + p[u] - p[v];
+            }
+        }
+    }
+    free(p);
+    return d;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file    graph_convert.c
+ * @brief   convert graph files between the formats of graph_io.c, e.g. a
+ *          genMatrix_floyd.c int file or a write_mat.py float32 file to
+ *          the apsp format, tile major with -f apsp:f32:64.  The input
+ *          format is worked out from the file; its layout goes to stderr.
+ *
+ *          usage: graph-convert [-f int|raw|apsp[:f32|i32|u16][:tile]] infile outfile
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "floyd.h"
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-f int|raw|apsp[:f32|i32|u16][:tile]] infile outfile\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char* formats[] = { "int", "raw", "apsp" };
+    static const char* dtypes[] = { "f32", "i32", "u16" };
+    graph_info_t in, out;
+    float* d;
+    int n, opt;
+
+    graph_layout("apsp", &out);
+    while((opt = getopt(argc, argv, "f:")) != -1) {
+        switch(opt) {
+        case 'f': if(graph_layout(optarg, &out)) usage(argv[0]); break;
+        default:  usage(argv[0]);
+        }
+    }
+    if(argc - optind != 2) usage(argv[0]);
+
+    if(graph_probe(argv[optind], &in)) return 1;
+    fprintf(stderr, "%s: %s %s, n %d, tile %d, infinity %g\n", argv[optind],
+            formats[in.format], dtypes[in.dtype], in.n, in.tile, in.infinity);
+
+    if((d = graph_read(argv[optind], &n)) == NULL) return 1;
+    if(graph_write(argv[optind + 1], d, n, &out)) return 1;
+
+    free(d);
+    return 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * @file    graph_io.c
+ * @brief   graph files.  Reads the two formats already in p3, which carry
+ *          neither the element type nor the "no edge" encoding:
+ *
+ *            int      int n, int n, then n x n ints row major, 1 << 29 or
+ *                     more for "no edge" (wjiang's genMatrix_floyd.c)
+ *            raw      n x n float32 and nothing else (jbut's write_mat.py)
+ *
+ *          and reads and writes a versioned one that does:
+ *
+ *            apsp     a 64 byte header, then the matrix as f32, i32 or
+ *                     u16, row major or tile major
+ *
+ *          apsp header, little endian as written by x86:
+ *
+ *             0  char[8]  "APSPGRPH"
+ *             8  uint32   version (GRAPH_VERSION)
+ *            12  uint32   dtype, a graph_dtype_t
+ *            16  uint64   n
+ *            24  uint32   tile edge, 0 for row major
+ *            28  uint32   header bytes (64), where the matrix starts
+ *            32  double   infinity: this value or more means "no edge"
+ *            40           zero to 64
+ *
+ *          Tile major stores the tile x tile tiles in row major order of
+ *          tiles, each tile row major and the ones on the right and bottom
+ *          edges cut to fit, so tile (ib,jb) is one contiguous run of the
+ *          file and a blocked or checkerboard reader can take it in one
+ *          read.  Row major is the same thing with 1 x n "tiles", which is
+ *          how the readers and writers here walk both.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "floyd.h"
+
+/* Defines */
+#define GRAPH_MAGIC    "APSPGRPH"
+#define GRAPH_VERSION  1
+#define GRAPH_HEADER   64
+
+static const char* dtype_names[] = { "f32", "i32", "u16" };
+
+/**
+ * @name     graph_layout
+ * @brief    a layout for graph_write from "int", "raw" or
+ *           "apsp[:f32|i32|u16][:tile]"; n is left alone
+ * @returns  0, or 1 if spec is not one of those
+ *
+ ******************************************************************************/
+int graph_layout(const char* spec, graph_info_t* info)
+{
+    const char* s;
+    size_t len;
+    int d;
+
+    info->tile = 0;
+    if(strcmp(spec, "int") == 0) {
+        info->format = GRAPH_INT32;
+        info->dtype = GRAPH_I32;
+        info->infinity = GRAPH_INFTY;
+        info->offset = 2 * sizeof(int);
+        return 0;
+    }
+    if(strcmp(spec, "raw") == 0) {
+        info->format = GRAPH_RAW32;
+        info->dtype = GRAPH_F32;
+        info->infinity = FLOYD_INF;
+        info->offset = 0;
+        return 0;
+    }
+    if(strncmp(spec, "apsp", 4) != 0 || (spec[4] != '\0' && spec[4] != ':')) return 1;
+
+    info->format = GRAPH_APSP;
+    info->dtype = GRAPH_F32;
+    info->offset = GRAPH_HEADER;
+    for(s = spec + 4; *s == ':'; s += len) {
+        char* end;
+
+        len = strcspn(++s, ":");
+        for(d = GRAPH_F32; d <= GRAPH_U16; d++) {
+            if(len == 3 && strncmp(s, dtype_names[d], 3) == 0) break;
+        }
+        if(d <= GRAPH_U16) {
+            info->dtype = (graph_dtype_t)d;
+        } else if((info->tile = strtol(s, &end, 10)) < 1 || end != s + len) {
+            return 1;
+        }
+    }
+    if(*s != '\0') return 1;
+    info->infinity = info->dtype == GRAPH_U16 ? 65535 :
+                     info->dtype == GRAPH_I32 ? GRAPH_INFTY : FLOYD_INF;
+    return 0;
+}
+
+/**
+ * @name     graph_dtype_parse
+ * @brief    the dtype called f32, i32 or u16, -1 for anything else
+ *
+ ******************************************************************************/
+int graph_dtype_parse(const char* name)
+{
+    int d;
+
+    for(d = GRAPH_F32; d <= GRAPH_U16; d++) {
+        if(strcmp(name, dtype_names[d]) == 0) return d;
+    }
+    return -1;
+}
+
+size_t graph_dtype_size(graph_dtype_t dtype)
+{
+    return dtype == GRAPH_U16 ? 2 : 4;
+}
+
+/**
+ * @name     graph_index
+ * @brief    element number of (i,j) in the file, counted from offset
+ *
+ ******************************************************************************/
+size_t graph_index(const graph_info_t* info, int i, int j)
+{
+    size_t n = info->n;
+    int t = info->tile ? info->tile : info->n;
+    int ib = i / t, jb = j / t;
+    int rows = MIN(t, info->n - ib * t);
+    int cols = MIN(t, info->n - jb * t);
+
+    return (size_t)ib * t * n + (size_t)jb * t * rows + (size_t)(i - ib * t) * cols + (j - jb * t);
+}
+
+/**
+ * @name     graph_probe
+ * @brief    work out the layout of a graph file from its header, or for
+ *           the two older formats from its size
+ * @returns  0 with info filled in, 1 after reporting an error
+ *
+ ******************************************************************************/
+int graph_probe(const char* path, graph_info_t* info)
+{
+    FILE* fp = fopen(path, "rb");
+    unsigned char h[GRAPH_HEADER];
+    int dims[2] = { 0, 0 };
+    long size, got, m;
+
+    if(fp == NULL) {
+        perror(path);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    got = fread(h, 1, sizeof(h), fp);
+    fclose(fp);
+
+    if(got == GRAPH_HEADER && memcmp(h, GRAPH_MAGIC, 8) == 0) {
+        uint32_t version, dtype, tile, header;
+        uint64_t n;
+
+        memcpy(&version, h + 8, 4);
+        memcpy(&dtype, h + 12, 4);
+        memcpy(&n, h + 16, 8);
+        memcpy(&tile, h + 24, 4);
+        memcpy(&header, h + 28, 4);
+        memcpy(&info->infinity, h + 32, 8);
+        if(version > GRAPH_VERSION || dtype > GRAPH_U16 || n < 1 || n > 0x7fffffff) {
+            fprintf(stderr, "%s: unsupported apsp graph, version %u dtype %u n %lu\n",
+                    path, version, dtype, (unsigned long)n);
+            return 1;
+        }
+        info->n = n;
+        info->format = GRAPH_APSP;
+        info->dtype = (graph_dtype_t)dtype;
+        info->tile = tile;
+        info->offset = header;
+        if(size != header + (long)(n * n * graph_dtype_size(info->dtype))) {
+            fprintf(stderr, "%s: %ld bytes, expected %ld\n", path, size,
+                    header + (long)(n * n * graph_dtype_size(info->dtype)));
+            return 1;
+        }
+        return 0;
+    }
+
+    if(got >= 8) memcpy(dims, h, sizeof(dims));
+    m = lrint(sqrt(size / 4.0));
+    if(dims[0] > 0 && dims[0] == dims[1] &&
+       size == 2 * sizeof(int) + (long)dims[0] * dims[0] * sizeof(int)) {
+        graph_layout("int", info);
+        info->n = dims[0];
+    } else if(size > 0 && m * m * 4 == size) {
+        graph_layout("raw", info);
+        info->n = m;
+    } else {
+        fprintf(stderr, "%s: not a square graph matrix\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @name     graph_decode
+ * @brief    turn count elements as read from a file into distances; in may
+ *           be out, as no element is wider than a float
+ *
+ ******************************************************************************/
+void graph_decode(const void* in, float* out, size_t count, const graph_info_t* info)
+{
+    float inf = info->infinity;
+    size_t i;
+
+    // back to front, so that narrower elements decode in place
+    for(i = count; i-- > 0; ) {
+        float x = info->dtype == GRAPH_U16 ? ((const uint16_t*)in)[i] :
+                  info->dtype == GRAPH_I32 ? ((const int32_t*)in)[i] :
+                  ((const float*)in)[i];
+        out[i] = x >= inf ? FLOYD_INF : x;
+    }
+}
+
+/**
+ * @name     graph_encode
+ * @brief    distances as the elements of a file; out may be in
+ * @returns  how many were rounded or clamped to fit
+ *
+ ******************************************************************************/
+long graph_encode(const float* in, void* out, size_t count, const graph_info_t* info)
+{
+    float inf = info->infinity;
+    long lossy = 0;
+    size_t i;
+
+    for(i = 0; i < count; i++) {
+        float x = in[i];
+
+        if(x >= inf) {
+            lossy += x < FLOYD_INF;
+            x = inf;
+        } else if(info->dtype != GRAPH_F32) {
+            if(x != rintf(x) || (info->dtype == GRAPH_U16 && x < 0)) lossy++;
+            x = info->dtype == GRAPH_U16 ? MAX(rintf(x), 0) : rintf(x);
+        }
+
+        if(info->dtype == GRAPH_U16) {
+            ((uint16_t*)out)[i] = x;
+        } else if(info->dtype == GRAPH_I32) {
+            ((int32_t*)out)[i] = x;
+        } else {
+            ((float*)out)[i] = x;
+        }
+    }
+    return lossy;
+}
+
+/**
+ * @name     graph_header
+ * @brief    the bytes before the matrix, info->offset of them
+ *
+ ******************************************************************************/
+int graph_header(const graph_info_t* info, void* buf)
+{
+    unsigned char* h = (unsigned char*)buf;
+    uint32_t version = GRAPH_VERSION, dtype = info->dtype, tile = info->tile, header = GRAPH_HEADER;
+    uint64_t n = info->n;
+    int dims[2] = { info->n, info->n };
+
+    if(info->format == GRAPH_INT32) {
+        memcpy(h, dims, sizeof(dims));
+    } else if(info->format == GRAPH_APSP) {
+        memset(h, 0, GRAPH_HEADER);
+        memcpy(h, GRAPH_MAGIC, 8);
+        memcpy(h + 8, &version, 4);
+        memcpy(h + 12, &dtype, 4);
+        memcpy(h + 16, &n, 8);
+        memcpy(h + 24, &tile, 4);
+        memcpy(h + 28, &header, 4);
+        memcpy(h + 32, &info->infinity, 8);
+    }
+    return info->offset;
+}
+
+/**
+ * @name     graph_read
+ * @brief    read a whole graph file of any of the formats, a tile (or a
+ *           row) per read
+ * @returns  the n x n distance matrix, NULL after reporting an error
+ *
+ ******************************************************************************/
+float* graph_read(const char* path, int* n)
+{
+    graph_info_t info;
+    FILE* fp;
+    float* d;
+    float* buf;
+    int th, tw, i0, j0, i;
+
+    if(graph_probe(path, &info)) return NULL;
+    if((fp = fopen(path, "rb")) == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    *n = info.n;
+    th = info.tile ? info.tile : 1;
+    tw = info.tile ? info.tile : info.n;
+    d = (float*)malloc((size_t)*n * *n * sizeof(float));
+    buf = (float*)malloc((size_t)th * tw * sizeof(float));
+    if(d == NULL || buf == NULL) {
+        fprintf(stderr, "graph_read: out of memory\n");
+        exit(1);
+    }
+
+    fseek(fp, info.offset, SEEK_SET);
+    for(i0 = 0; i0 < *n; i0 += th) {
+        for(j0 = 0; j0 < *n; j0 += tw) {
+            int rows = MIN(th, *n - i0), cols = MIN(tw, *n - j0);
+
+            if(fread(buf, graph_dtype_size(info.dtype), (size_t)rows * cols, fp) != (size_t)rows * cols) {
+                fprintf(stderr, "%s: short read at row %d column %d\n", path, i0, j0);
+                free(buf);
+                free(d);
+                fclose(fp);
+                return NULL;
+            }
+            graph_decode(buf, buf, (size_t)rows * cols, &info);
+            for(i = 0; i < rows; i++) {
+                memcpy(d + (size_t)(i0 + i) * *n + j0, buf + (size_t)i * cols, cols * sizeof(float));
+            }
+        }
+    }
+
+    free(buf);
+    fclose(fp);
+    return d;
+}
+
+/**
+ * @name     graph_write
+ * @brief    write d in the given layout, the int format if layout is NULL
+ * @returns  0 on success, 1 after reporting an error
+ *
+ ******************************************************************************/
+int graph_write(const char* path, const float* d, int n, const graph_info_t* layout)
+{
+    graph_info_t info;
+    unsigned char header[GRAPH_HEADER];
+    FILE* fp = fopen(path, "wb");
+    float* buf;
+    long lossy = 0;
+    int th, tw, i0, j0, i;
+
+    if(fp == NULL) {
+        perror(path);
+        return 1;
+    }
+    if(layout) {
+        info = *layout;
+    } else {
+        graph_layout("int", &info);
+    }
+    info.n = n;
+    th = info.tile ? info.tile : 1;
+    tw = info.tile ? info.tile : n;
+    buf = (float*)malloc((size_t)th * tw * sizeof(float));
+
+    fwrite(header, 1, graph_header(&info, header), fp);
+    for(i0 = 0; i0 < n; i0 += th) {
+        for(j0 = 0; j0 < n; j0 += tw) {
+            int rows = MIN(th, n - i0), cols = MIN(tw, n - j0);
+
+            for(i = 0; i < rows; i++) {
+                memcpy(buf + (size_t)i * cols, d + (size_t)(i0 + i) * n + j0, cols * sizeof(float));
+            }
+            lossy += graph_encode(buf, buf, (size_t)rows * cols, &info);
+            fwrite(buf, graph_dtype_size(info.dtype), (size_t)rows * cols, fp);
+        }
+    }
+    free(buf);
+
+    if(lossy) fprintf(stderr, "%s: %ld distances rounded or clamped to fit %s\n",
+                      path, lossy, dtype_names[info.dtype]);
+    if(fclose(fp) != 0) {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+/**
+ * @file    graph_mpi.c
+ * @brief   collective MPI-IO loader and writer for graph files, shared by
+ *          the p3 MPI drivers.
+ *
+ *          Each rank describes its rows x cols block at (low, left) of the
+ *          n x n matrix with an hindexed file view of the runs it covers,
+ *          so a row stripe and a checkerboard block, of a row major or a
+ *          tile major file (graph_io.c), are the same call, and MPI-IO is
+ *          free to merge the requests (two phase collective buffering)
+ *          into large contiguous file accesses.  Compare Quinn's
+ *          read_row_striped_matrix, which has rank p-1 read every row and
+ *          send it on one MPI_Send at a time.
+ *
+ *          Blocks are limited to INT_MAX elements, the MPI count type.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graph_mpi.h"
+
+/**
+ * @name     all_ok
+ * @brief    combine the ranks' error flags
+ * @returns  0 if no rank failed, 1 otherwise
+ *
+ ******************************************************************************/
+static int all_ok(int error, MPI_Comm comm)
+{
+    int errors;
+
+    MPI_Allreduce(&error, &errors, 1, MPI_INT, MPI_MAX, comm);
+    return errors;
+}
+
+static MPI_Datatype dtype_mpi(graph_dtype_t dtype)
+{
+    return dtype == GRAPH_U16 ? MPI_UNSIGNED_SHORT : dtype == GRAPH_I32 ? MPI_INT : MPI_FLOAT;
+}
+
+/**
+ * @name     block_runs
+ * @brief    the runs of this rank's rows x cols block at (low, left) that
+ *           are contiguous in the file, in file order: a row at a time
+ *           for row major files, a tile row at a time for tile major ones
+ * @param
+ *       @name   disp
+ *       @dir    O
+ *       @type   MPI_Aint*
+ *       @brief  byte offset of each run from info->offset, or NULL to
+ *               just count them
+ * @param
+ *       @name   dest
+ *       @dir    O
+ *       @type   size_t*
+ *       @brief  where each run goes in the row major rows x cols block
+ * @returns  number of runs
+ *
+ ******************************************************************************/
+static int block_runs(const graph_info_t* info, int low, int rows, int left, int cols,
+                      MPI_Aint* disp, int* len, size_t* dest)
+{
+    int th = info->tile ? info->tile : 1;
+    int tw = info->tile ? info->tile : info->n;
+    int i0, j0, i, runs = 0;
+
+    for(i0 = low / th * th; i0 < low + rows; i0 += th) {
+        for(j0 = left / tw * tw; j0 < left + cols; j0 += tw) {
+            int r0 = MAX(i0, low), r1 = MIN(i0 + th, low + rows);
+            int c0 = MAX(j0, left), c1 = MIN(j0 + tw, left + cols);
+
+            for(i = r0; i < r1; i++, runs++) {
+                if(disp == NULL) continue;
+                disp[runs] = graph_index(info, i, c0) * graph_dtype_size(info->dtype);
+                len[runs] = c1 - c0;
+                dest[runs] = (size_t)(i - low) * cols + (c0 - left);
+            }
+        }
+    }
+    return runs;
+}
+
+/**
+ * @name     block_open
+ * @brief    open path on comm with the view set to this rank's block
+ * @param
+ *       @name   len, dest
+ *       @dir    O
+ *       @type   int**, size_t**
+ *       @brief  the runs the view is made of, in file order, for the
+ *               caller to free
+ * @returns  number of runs, -1 on every rank if the open failed anywhere
+ *
+ ******************************************************************************/
+static int block_open(const char* path, MPI_Comm comm, int amode, const graph_info_t* info,
+                      int low, int rows, int left, int cols,
+                      MPI_File* fh, int** len, size_t** dest)
+{
+    int runs = block_runs(info, low, rows, left, cols, NULL, NULL, NULL);
+    MPI_Aint* disp;
+    MPI_Datatype view;
+    int error;
+
+    error = MPI_File_open(comm, (char*)path, amode, MPI_INFO_NULL, fh) != MPI_SUCCESS;
+    if(all_ok(error, comm)) {
+        fprintf(stderr, "%s: MPI_File_open failed\n", path);
+        return -1;
+    }
+
+    disp = (MPI_Aint*)malloc(MAX(runs, 1) * sizeof(MPI_Aint));
+    *len = (int*)malloc(MAX(runs, 1) * sizeof(int));
+    *dest = (size_t*)malloc(MAX(runs, 1) * sizeof(size_t));
+    block_runs(info, low, rows, left, cols, disp, *len, *dest);
+
+    MPI_Type_create_hindexed(runs, *len, disp, dtype_mpi(info->dtype), &view);
+    MPI_Type_commit(&view);
+    MPI_File_set_view(*fh, info->offset, dtype_mpi(info->dtype), view, "native", MPI_INFO_NULL);
+    MPI_Type_free(&view);
+    free(disp);
+    return runs;
+}
+
+/**
+ * @name     io_done
+ * @brief    fill in io from this rank's share of a collective
+ *
+ ******************************************************************************/
+static void io_done(graph_io_t* io, double bytes, double seconds, MPI_Comm comm)
+{
+    if(io == NULL) return;
+    MPI_Allreduce(&bytes, &io->bytes, 1, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(&seconds, &io->seconds, 1, MPI_DOUBLE, MPI_MAX, comm);
+}
+
+/**
+ * @name     graph_probe_mpi
+ * @brief    graph_probe on rank 0 of comm, the result sent to everyone
+ *
+ ******************************************************************************/
+int graph_probe_mpi(const char* path, MPI_Comm comm, graph_info_t* info)
+{
+    int id, error = 0;
+
+    MPI_Comm_rank(comm, &id);
+    if(!id) error = graph_probe(path, info);
+    MPI_Bcast(&error, 1, MPI_INT, 0, comm);
+    if(error) return 1;
+    MPI_Bcast(info, sizeof(*info), MPI_BYTE, 0, comm);
+    return 0;
+}
+
+/**
+ * @name     graph_read_block
+ * @brief    read this rank's rows x cols block at (low, left) into a
+ * @param
+ *       @name   info
+ *       @dir    I
+ *       @type   const graph_info_t*
+ *       @brief  the file's layout, from graph_probe_mpi
+ * @param
+ *       @name   a
+ *       @dir    O
+ *       @type   float*
+ *       @brief  rows x cols distances, row major
+ *
+ ******************************************************************************/
+int graph_read_block(const char* path, MPI_Comm comm, const graph_info_t* info,
+                     int low, int rows, int left, int cols, float* a, graph_io_t* io)
+{
+    size_t total = (size_t)rows * cols, at;
+    MPI_File fh;
+    MPI_Status status;
+    int* len;
+    size_t* dest;
+    int runs, r, count = 0, error;
+    float* buf;
+    double seconds = -MPI_Wtime();
+
+    if((runs = block_open(path, comm, MPI_MODE_RDONLY, info, low, rows, left, cols,
+                          &fh, &len, &dest)) < 0) return 1;
+
+    // no element is wider than a float, so the elements can be read where
+    // their distances go when the runs are in block order (row major)
+    buf = info->tile ? (float*)malloc(MAX(total, 1) * sizeof(float)) : a;
+    MPI_File_read_at_all(fh, 0, buf, total, dtype_mpi(info->dtype), &status);
+    MPI_Get_count(&status, dtype_mpi(info->dtype), &count);
+    MPI_File_close(&fh);
+    seconds += MPI_Wtime();
+
+    error = (size_t)count != total;
+    if(error) {
+        fprintf(stderr, "%s: short read, %d of %zu elements at row %d\n", path, count, total, low);
+    }
+    if(!all_ok(error, comm)) {
+        graph_decode(buf, buf, total, info);
+        for(r = 0, at = 0; buf != a && r < runs; at += len[r++]) {
+            memcpy(a + dest[r], buf + at, len[r] * sizeof(float));
+        }
+        io_done(io, (double)total * graph_dtype_size(info->dtype), seconds, comm);
+    }
+
+    if(buf != a) free(buf);
+    free(len);
+    free(dest);
+    return error;
+}
+
+/**
+ * @name     graph_write_block
+ * @brief    write this rank's block into a file of the given layout (the
+ *           int format if layout is NULL); rank 0 writes the header
+ *
+ ******************************************************************************/
+int graph_write_block(const char* path, MPI_Comm comm, int n, const graph_info_t* layout,
+                      int low, int rows, int left, int cols, const float* a, graph_io_t* io)
+{
+    size_t total = (size_t)rows * cols, at;
+    float* buf = (float*)malloc(MAX(total, 1) * sizeof(float));
+    unsigned char header[64];
+    graph_info_t info;
+    MPI_File fh;
+    MPI_Status status;
+    int* len;
+    size_t* dest;
+    long lossy;
+    int id, runs, r, error;
+    double seconds = -MPI_Wtime();
+
+    if(layout) {
+        info = *layout;
+    } else {
+        graph_layout("int", &info);
+    }
+    info.n = n;
+    MPI_Comm_rank(comm, &id);
+
+    if((runs = block_open(path, comm, MPI_MODE_WRONLY | MPI_MODE_CREATE, &info,
+                          low, rows, left, cols, &fh, &len, &dest)) < 0) {
+        free(buf);
+        return 1;
+    }
+
+    // the block in file order, encoded in place
+    for(r = 0, at = 0; r < runs; at += len[r++]) {
+        memcpy(buf + at, a + dest[r], len[r] * sizeof(float));
+    }
+    lossy = graph_encode(buf, buf, total, &info);
+    MPI_Allreduce(MPI_IN_PLACE, &lossy, 1, MPI_LONG, MPI_SUM, comm);
+    if(!id && lossy) fprintf(stderr, "%s: %ld distances rounded or clamped to fit\n", path, lossy);
+
+    MPI_File_set_size(fh, 0);
+    error = MPI_File_write_at_all(fh, 0, buf, total, dtype_mpi(info.dtype), &status) != MPI_SUCCESS;
+
+    // the header lies outside every block's view
+    MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    if(!id) MPI_File_write_at(fh, 0, header, graph_header(&info, header), MPI_BYTE, &status);
+    MPI_File_close(&fh);
+    seconds += MPI_Wtime();
+    free(buf);
+    free(len);
+    free(dest);
+
+    if(all_ok(error, comm)) {
+        fprintf(stderr, "%s: MPI_File_write_at_all failed\n", path);
+        return 1;
+    }
+    io_done(io, (double)total * graph_dtype_size(info.dtype), seconds, comm);
+    return 0;
+}
+
+/**
+ * @name     csr_gather
+ * @brief    the whole graph in CSR form on every rank, from the row stripes
+ *           a (rows x n at row low) the ranks of comm hold
+ *
+ ******************************************************************************/
+csr_t* csr_gather(const float* a, int n, int low, int rows, MPI_Comm comm)
+{
+    int* degree = (int*)malloc(n * sizeof(int));
+    int* counts;
+    int* displs;
+    int p, r, i, j;
+    csr_t* g;
+    long m, e;
+
+    MPI_Comm_size(comm, &p);
+    MPI_Comm_rank(comm, &r);
+    counts = (int*)malloc(p * sizeof(int));
+    displs = (int*)malloc(p * sizeof(int));
+
+    // out degrees of every vertex, each rank filling in its stripe
+    for(i = 0; i < rows; i++) {
+        degree[low + i] = 0;
+        for(j = 0; j < n; j++) {
+            if(low + i != j && a[(size_t)i*n + j] < FLOYD_INF) degree[low + i]++;
+        }
+    }
+    MPI_Allgather(&rows, 1, MPI_INT, counts, 1, MPI_INT, comm);
+    MPI_Allgather(&low, 1, MPI_INT, displs, 1, MPI_INT, comm);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_INT, degree, counts, displs, MPI_INT, comm);
+
+    for(i = 0, m = 0; i < n; i++) m += degree[i];
+    g = csr_alloc(n, m);
+    for(i = 0, e = 0; i < n; i++) {
+        g->row[i] = e;
+        e += degree[i];
+    }
+    g->row[n] = e;
+
+    // then the edges, which the stripes hold in rank order
+    for(i = 0, e = g->row[low]; i < rows; i++) {
+        for(j = 0; j < n; j++) {
+            if(low + i != j && a[(size_t)i*n + j] < FLOYD_INF) {
+                g->col[e] = j;
+                g->w[e++] = a[(size_t)i*n + j];
+            }
+        }
+    }
+    for(i = 0; i < p; i++) {
+        int last = i + 1 < p ? displs[i + 1] : n;
+        counts[i] = g->row[last] - g->row[displs[i]];
+        displs[i] = g->row[displs[i]];
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_INT, g->col, counts, displs, MPI_INT, comm);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_FLOAT, g->w, counts, displs, MPI_FLOAT, comm);
+
+    free(degree);
+    free(counts);
+    free(displs);
+    return g;
+}
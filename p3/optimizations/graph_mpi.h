@@ -0,0 +1,31 @@
+/**
+ * @file    graph_mpi.h
+ * @brief   collective MPI-IO for graph files: every rank reads or writes
+ *          its own block of the matrix straight from or to the file, in
+ *          one MPI_File_read_at_all / MPI_File_write_at_all, instead of
+ *          the whole matrix going through rank 0.
+ *
+ */
+#ifndef __GRAPH_MPI_H__
+#define __GRAPH_MPI_H__
+
+#include <mpi.h>
+
+#include "floyd.h"
+
+/* what one collective moved, the same on every rank */
+typedef struct {
+    double bytes;                   // summed over the ranks
+    double seconds;                 // slowest rank, open to close
+} graph_io_t;
+
+/* graph_mpi.c; all collective over comm, 0 on success, 1 on every rank
+   after one of them reported an error */
+int graph_probe_mpi(const char* path, MPI_Comm comm, graph_info_t* info);
+int graph_read_block(const char* path, MPI_Comm comm, const graph_info_t* info,
+                     int low, int rows, int left, int cols, float* a, graph_io_t* io);
+int graph_write_block(const char* path, MPI_Comm comm, int n, const graph_info_t* layout,
+                      int low, int rows, int left, int cols, const float* a, graph_io_t* io);
+csr_t* csr_gather(const float* a, int n, int low, int rows, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file    incr_bench.c
+ * @brief   latency of incremental APSP updates (incremental.c) against a
+ *          full blocked Floyd solve.  For each n: solve a random graph of
+ *          out degree INCR_DEGREE, apply INCR_UPDATES edge decreases and as
+ *          many increases (half of those removals) to edges on shortest
+ *          paths, timing each one, then solve the updated graph from
+ *          scratch and check the two agree.
+ *
+ *          Prints "n, op, updates, mean_ms, max_ms, mean_rows, full_s,
+ *          speedup", speedup being the full solve over the mean update.
+ *
+ *          usage: incr-bench [n ...]
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "floyd.h"
+
+/* Defines */
+#define INCR_DEGREE   8
+#define INCR_MAXW     100
+#define INCR_UPDATES  16
+
+static double now(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void report(int n, const char* op, const double* ms, const int* rows, int count, double full)
+{
+    double sum = 0, max = 0, touched = 0;
+    int i;
+
+    for(i = 0; i < count; i++) {
+        sum += ms[i];
+        max = MAX(max, ms[i]);
+        touched += rows[i];
+    }
+    printf("%d, %s, %d, %f, %f, %.1f, %f, %.0f\n", n, op, count, sum / count, max,
+           touched / count, full, full * 1000 / (sum / count));
+}
+
+int main(int argc, char *argv[])
+{
+    int sizes[16] = { 4096, 8192 };
+    int nsizes = 2;
+    unsigned seed = 1;
+    int s, k;
+
+    if(argc > 1) {
+        for(nsizes = 0; nsizes < argc - 1 && nsizes < 16; nsizes++) {
+            sizes[nsizes] = atoi(argv[nsizes + 1]);
+        }
+    }
+
+    printf("n, op, updates, mean_ms, max_ms, mean_rows, full_s, speedup\n");
+    for(s = 0; s < nsizes; s++) {
+        int n = sizes[s];
+        size_t nn = (size_t)n * n;
+        float* g = graph_components(n, 1, INCR_DEGREE, INCR_MAXW, 0, seed);
+        float* d = (float*)malloc(nn * sizeof(float));
+        double down[INCR_UPDATES], up[INCR_UPDATES], full, t;
+        int rows_down[INCR_UPDATES], rows_up[INCR_UPDATES];
+        size_t bad;
+
+        memcpy(d, g, nn * sizeof(float));
+        t = now();
+        floyd_run(ALGO_BLOCKED, d, n, FLOYD_TILE, NULL);
+        full = now() - t;
+
+        for(k = 0; k < INCR_UPDATES; k++) {
+            int u = rand_r(&seed) % n, v = rand_r(&seed) % n;
+
+            // a shortcut to half the current distance
+            if(u == v) v = (v + 1) % n;
+            t = now();
+            rows_down[k] = apsp_update(g, d, n, u, v, MAX(1, floorf(d[(size_t)u*n + v] / 2)));
+            down[k] = (now() - t) * 1000;
+
+            // an edge that is itself a shortest path, made 4x longer or cut
+            do {
+                u = rand_r(&seed) % n;
+                for(v = 0; v < n; v++) {
+                    if(v != u && g[(size_t)u*n + v] < FLOYD_INF &&
+                       g[(size_t)u*n + v] == d[(size_t)u*n + v]) break;
+                }
+            } while(v == n);
+            t = now();
+            rows_up[k] = apsp_update(g, d, n, u, v, k & 1 ? FLOYD_INF : 4 * g[(size_t)u*n + v]);
+            up[k] = (now() - t) * 1000;
+        }
+        report(n, "decrease", down, rows_down, INCR_UPDATES, full);
+        report(n, "increase", up, rows_up, INCR_UPDATES, full);
+
+        // the updated graph solved from scratch, in place of its edges,
+        // must give the same distances
+        floyd_run(ALGO_BLOCKED, g, n, FLOYD_TILE, NULL);
+        for(bad = 0; bad < nn && g[bad] == d[bad]; bad++);
+        if(bad < nn) {
+            printf("Array error! i = %zu j= %zu incremental %f full %f\n", bad / n, bad % n, d[bad], g[bad]);
+            return 1;
+        }
+
+        free(g);
+        free(d);
+    }
+    return 0;
+}
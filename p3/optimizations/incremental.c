@@ -0,0 +1,174 @@
+/**
+ * @file    incremental.c
+ * @brief   all pairs shortest paths kept up to date as single edges change,
+ *          instead of a fresh n^3 solve per change.  The caller keeps the
+ *          edge weights g (n x n, FLOYD_INF for no edge) beside the solved
+ *          distances d.
+ *
+ *          A decrease of u -> v to w can only help paths that take the new
+ *          edge, so d[i][j] = min(d[i][j], d[i][u] + w + d[v][j]): one min-
+ *          plus pass over the matrix, O(n^2), with the row kernels.
+ *
+ *          An increase (or removal, w = FLOYD_INF) can only hurt the
+ *          sources i that reached v through the old edge, the rows where
+ *          d[i][u] + old == d[i][v], and in those rows only the targets j
+ *          with d[i][j] == d[i][u] + old + d[v][j].  Just those entries are
+ *          recomputed, by a Dijkstra confined to them (dijkstra_repair in
+ *          sparse.c), so the cost follows how many shortest paths went
+ *          through the edge rather than n^3.  Dijkstra needs non-negative
+ *          weights; with a negative edge anywhere an increase falls back
+ *          to a full blocked Floyd.
+ *
+ *          Distances only: a next hop matrix is not maintained.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "floyd.h"
+
+/* Defines */
+#define INCR_SLACK  1e-6f   // relative slack when matching d[i][u] + old to d[i][v]
+
+/**
+ * @name     apsp_decrease
+ * @brief    lower edge u -> v to w and bring d up to date
+ * @returns  number of source rows relaxed, -1 (and nothing changed) if the
+ *           edge would close a negative cycle
+ *
+ ******************************************************************************/
+int apsp_decrease(float* g, float* d, int n, int u, int v, float w)
+{
+    float* col = (float*)malloc(n * sizeof(float));
+    float* row = (float*)malloc(n * sizeof(float));
+    int i, rows = 0;
+
+    minplus_kernel();       // pick the row kernel before any thread needs it
+    if(d[(size_t)v*n + u] + w < 0) {
+        free(col);
+        free(row);
+        return -1;
+    }
+    g[(size_t)u*n + v] = w;
+    if(w >= d[(size_t)u*n + v]) {       // already as short another way
+        free(col);
+        free(row);
+        return 0;
+    }
+
+    // column u and row v do not change (that would take a negative cycle)
+    // but the pass overwrites them, so work from copies
+    memcpy(row, d + (size_t)v*n, n * sizeof(float));
+    for(i = 0; i < n; i++) {
+        col[i] = d[(size_t)i*n + u];
+    }
+
+    #pragma omp parallel for reduction(+:rows) schedule(static)
+    for(i = 0; i < n; i++) {
+        if(col[i] < FLOYD_INF) {
+            minplus_f32(d + (size_t)i*n, row, col[i] + w, n);
+            rows++;
+        }
+    }
+
+    free(col);
+    free(row);
+    return rows;
+}
+
+/**
+ * @name     apsp_increase
+ * @brief    raise edge u -> v to w (FLOYD_INF removes it) and bring d up to
+ *           date
+ * @returns  number of source rows recomputed
+ *
+ ******************************************************************************/
+int apsp_increase(float* g, float* d, int n, int u, int v, float w)
+{
+    float old = g[(size_t)u*n + v];
+    int* rows = (int*)malloc(n * sizeof(int));
+    long negative = 0;
+    int i, j, count = 0;
+    csr_t* csr;
+    csr_t* gt;
+    float* rowv;
+
+    g[(size_t)u*n + v] = w;
+
+    #pragma omp parallel for private(j) reduction(+:negative) schedule(static)
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < n; j++) {
+            if(g[(size_t)i*n + j] < 0) negative++;
+        }
+    }
+    if(negative) {
+        memcpy(d, g, (size_t)n * n * sizeof(float));
+        for(i = 0; i < n; i++) {
+            d[(size_t)i*n + i] = MIN(d[(size_t)i*n + i], 0);
+        }
+        floyd_run(ALGO_BLOCKED, d, n, FLOYD_TILE, NULL);
+        free(rows);
+        return n;
+    }
+
+    // sources whose shortest path to v could have used the old edge; the
+    // slack keeps float rounding from hiding one, and extra rows or
+    // targets only cost time
+    for(i = 0; i < n; i++) {
+        float via = d[(size_t)i*n + u] + old;
+        float dv = d[(size_t)i*n + v];
+
+        if(via < FLOYD_INF && via <= dv + INCR_SLACK * dv) rows[count++] = i;
+    }
+    if(count == 0) {
+        free(rows);
+        return 0;
+    }
+
+    csr = csr_from_dense(g, n);
+    gt = csr_transpose(csr);
+    rowv = (float*)malloc(n * sizeof(float));
+    memcpy(rowv, d + (size_t)v*n, n * sizeof(float));
+
+    #pragma omp parallel private(i, j)
+    {
+        char* stale = (char*)malloc(n);
+        int r;
+
+        #pragma omp for schedule(dynamic)
+        for(r = 0; r < count; r++) {
+            float* di = d + (size_t)rows[r]*n;
+            float via = di[u] + old;
+
+            for(j = 0; j < n; j++) {
+                float dj = di[j];
+                stale[j] = dj < FLOYD_INF && via + rowv[j] <= dj + INCR_SLACK * dj;
+            }
+            dijkstra_repair(csr, gt, rows[r], di, stale);
+        }
+        free(stale);
+    }
+
+    csr_free(csr);
+    csr_free(gt);
+    free(rowv);
+    free(rows);
+    return count;
+}
+
+/**
+ * @name     apsp_update
+ * @brief    set edge u -> v to w, whichever way it moves
+ * @returns  as apsp_decrease or apsp_increase
+ *
+ ******************************************************************************/
+int apsp_update(float* g, float* d, int n, int u, int v, float w)
+{
+    if(u == v) return 0;
+    if(w < g[(size_t)u*n + v]) return apsp_decrease(g, d, n, u, v, w);
+    if(w > g[(size_t)u*n + v]) return apsp_increase(g, d, n, u, v, w);
+    return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file    minplus.c
+ * @brief   min-plus row kernels, c[j] = min(c[j], a + b[j]), the inner
+ *          statement of every Floyd engine, for float, int32 and uint16
+ *          rows, and float versions that also blend a next hop index into
+ *          nc[j] wherever the new distance is strictly shorter.
+ *
+ *          Float gets "no edge" for free from INFINITY.  The integer rows
+ *          use a sentinel instead, FLOYD_INF_I32 or FLOYD_INF_U16, and the
+ *          sum saturates at it: anything plus the sentinel is the
+ *          sentinel, so a negative a cannot pull an unreachable b[j] back
+ *          below it and an unreachable a never improves anything (the
+ *          plain a + b[j] of wjiang's and sjosh's loops gets both wrong).
+ *          uint16 does this with the unsigned saturating add, in twice the
+ *          lanes of the 32 bit types.  Rows must hold nothing above the
+ *          sentinel.
+ *
+ *          The body is picked once at run time from CPUID, or from the
+ *          FLOYD_KERNEL environment variable (scalar, avx2 or avx512).
+ *          Every version computes the same sum and minimum, so results are
+ *          bit-identical.  c and b may be the same row (the diagonal tile
+ *          does that) but must not otherwise overlap.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "floyd.h"
+
+typedef void (*minplus_f32_t)(float*, const float*, float, int);
+typedef void (*minplus_i32_t)(int*, const int*, int, int);
+typedef void (*minplus_u16_t)(unsigned short*, const unsigned short*, unsigned short, int);
+typedef void (*minplus_n32_t)(float*, const float*, float, int*, int, int);
+typedef void (*minplus_n16_t)(float*, const float*, float, short*, short, int);
+
+static void f32_scalar(float* c, const float* b, float a, int n)
+{
+    int j;
+
+    for(j = 0; j < n; j++) {
+        c[j] = MIN(c[j], a + b[j]);
+    }
+}
+
+static void i32_scalar(int* c, const int* b, int a, int n)
+{
+    int j;
+
+    if(a >= FLOYD_INF_I32) return;
+    for(j = 0; j < n; j++) {
+        int s = b[j] < FLOYD_INF_I32 ? a + b[j] : FLOYD_INF_I32;
+        c[j] = MIN(c[j], s);
+    }
+}
+
+static void u16_scalar(unsigned short* c, const unsigned short* b, unsigned short a, int n)
+{
+    int j;
+
+    for(j = 0; j < n; j++) {
+        int s = MIN(a + b[j], FLOYD_INF_U16);
+        c[j] = MIN(c[j], s);
+    }
+}
+
+// next hop versions: the distance is still a plain min, the index is a
+// blend on the same compare, written so the compiler can if-convert it
+static void n32_scalar(float* c, const float* b, float a, int* nc, int nk, int n)
+{
+    int j;
+
+    for(j = 0; j < n; j++) {
+        float s = a + b[j];
+        int better = s < c[j];
+        nc[j] = better ? nk : nc[j];
+        c[j] = MIN(c[j], s);
+    }
+}
+
+static void n16_scalar(float* c, const float* b, float a, short* nc, short nk, int n)
+{
+    int j;
+
+    for(j = 0; j < n; j++) {
+        float s = a + b[j];
+        int better = s < c[j];
+        nc[j] = better ? nk : nc[j];
+        c[j] = MIN(c[j], s);
+    }
+}
+
+__attribute__((target("avx2")))
+static void f32_avx2(float* c, const float* b, float a, int n)
+{
+    const __m256 va = _mm256_set1_ps(a);
+    int j;
+
+    for(j = 0; j + 8 <= n; j += 8) {
+        __m256 s = _mm256_add_ps(va, _mm256_loadu_ps(b + j));
+        _mm256_storeu_ps(c + j, _mm256_min_ps(_mm256_loadu_ps(c + j), s));
+    }
+    for(; j < n; j++) {
+        c[j] = MIN(c[j], a + b[j]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void i32_avx2(int* c, const int* b, int a, int n)
+{
+    const __m256i va = _mm256_set1_epi32(a);
+    const __m256i vinf = _mm256_set1_epi32(FLOYD_INF_I32);
+    const __m256i vfin = _mm256_set1_epi32(FLOYD_INF_I32 - 1);
+    int j;
+
+    if(a >= FLOYD_INF_I32) return;
+    for(j = 0; j + 8 <= n; j += 8) {
+        __m256i bj = _mm256_loadu_si256((const __m256i*)(b + j));
+        // where b[j] is the sentinel, so is the sum
+        __m256i s = _mm256_blendv_epi8(_mm256_add_epi32(va, bj), vinf, _mm256_cmpgt_epi32(bj, vfin));
+        __m256i m = _mm256_min_epi32(_mm256_loadu_si256((const __m256i*)(c + j)), s);
+        _mm256_storeu_si256((__m256i*)(c + j), m);
+    }
+    i32_scalar(c + j, b + j, a, n - j);
+}
+
+__attribute__((target("avx2")))
+static void u16_avx2(unsigned short* c, const unsigned short* b, unsigned short a, int n)
+{
+    const __m256i va = _mm256_set1_epi16(a);
+    int j;
+
+    // FLOYD_INF_U16 is the largest uint16, so the saturating add is all
+    for(j = 0; j + 16 <= n; j += 16) {
+        __m256i s = _mm256_adds_epu16(va, _mm256_loadu_si256((const __m256i*)(b + j)));
+        __m256i m = _mm256_min_epu16(_mm256_loadu_si256((const __m256i*)(c + j)), s);
+        _mm256_storeu_si256((__m256i*)(c + j), m);
+    }
+    u16_scalar(c + j, b + j, a, n - j);
+}
+
+__attribute__((target("avx2")))
+static void n32_avx2(float* c, const float* b, float a, int* nc, int nk, int n)
+{
+    const __m256 va = _mm256_set1_ps(a);
+    const __m256i vk = _mm256_set1_epi32(nk);
+    int j;
+
+    for(j = 0; j + 8 <= n; j += 8) {
+        __m256 s = _mm256_add_ps(va, _mm256_loadu_ps(b + j));
+        __m256 cj = _mm256_loadu_ps(c + j);
+        __m256 better = _mm256_cmp_ps(s, cj, _CMP_LT_OQ);
+        _mm256_maskstore_epi32(nc + j, _mm256_castps_si256(better), vk);
+        _mm256_storeu_ps(c + j, _mm256_min_ps(cj, s));
+    }
+    n32_scalar(c + j, b + j, a, nc + j, nk, n - j);
+}
+
+__attribute__((target("avx2")))
+static void n16_avx2(float* c, const float* b, float a, short* nc, short nk, int n)
+{
+    const __m256 va = _mm256_set1_ps(a);
+    const __m128i vk = _mm_set1_epi16(nk);
+    int j;
+
+    for(j = 0; j + 8 <= n; j += 8) {
+        __m256 s = _mm256_add_ps(va, _mm256_loadu_ps(b + j));
+        __m256 cj = _mm256_loadu_ps(c + j);
+        __m256i better = _mm256_castps_si256(_mm256_cmp_ps(s, cj, _CMP_LT_OQ));
+        // narrow the 8 x 32 bit mask to 8 x 16 bits to blend the indices
+        __m128i m16 = _mm_packs_epi32(_mm256_castsi256_si128(better), _mm256_extracti128_si256(better, 1));
+        __m128i nj = _mm_loadu_si128((const __m128i*)(nc + j));
+        _mm_storeu_si128((__m128i*)(nc + j), _mm_blendv_epi8(nj, vk, m16));
+        _mm256_storeu_ps(c + j, _mm256_min_ps(cj, s));
+    }
+    n16_scalar(c + j, b + j, a, nc + j, nk, n - j);
+}
+
+__attribute__((target("avx512f")))
+static void f32_avx512(float* c, const float* b, float a, int n)
+{
+    const __m512 va = _mm512_set1_ps(a);
+    int j;
+
+    for(j = 0; j < n; j += 16) {
+        // the tail is handled by masking rather than a scalar loop
+        __mmask16 k = n - j >= 16 ? 0xffff : (__mmask16)((1u << (n - j)) - 1);
+        __m512 s = _mm512_add_ps(va, _mm512_maskz_loadu_ps(k, b + j));
+        _mm512_mask_storeu_ps(c + j, k, _mm512_min_ps(_mm512_maskz_loadu_ps(k, c + j), s));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void i32_avx512(int* c, const int* b, int a, int n)
+{
+    const __m512i va = _mm512_set1_epi32(a);
+    const __m512i vinf = _mm512_set1_epi32(FLOYD_INF_I32);
+    int j;
+
+    if(a >= FLOYD_INF_I32) return;
+    for(j = 0; j < n; j += 16) {
+        __mmask16 k = n - j >= 16 ? 0xffff : (__mmask16)((1u << (n - j)) - 1);
+        __m512i bj = _mm512_maskz_loadu_epi32(k, b + j);
+        __m512i s = _mm512_mask_add_epi32(vinf, _mm512_cmplt_epi32_mask(bj, vinf), va, bj);
+        _mm512_mask_storeu_epi32(c + j, k, _mm512_min_epi32(_mm512_maskz_loadu_epi32(k, c + j), s));
+    }
+}
+
+__attribute__((target("avx512bw")))
+static void u16_avx512(unsigned short* c, const unsigned short* b, unsigned short a, int n)
+{
+    const __m512i va = _mm512_set1_epi16(a);
+    int j;
+
+    for(j = 0; j < n; j += 32) {
+        __mmask32 k = n - j >= 32 ? 0xffffffff : (__mmask32)((1u << (n - j)) - 1);
+        __m512i s = _mm512_adds_epu16(va, _mm512_maskz_loadu_epi16(k, b + j));
+        _mm512_mask_storeu_epi16(c + j, k, _mm512_min_epu16(_mm512_maskz_loadu_epi16(k, c + j), s));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void n32_avx512(float* c, const float* b, float a, int* nc, int nk, int n)
+{
+    const __m512 va = _mm512_set1_ps(a);
+    const __m512i vk = _mm512_set1_epi32(nk);
+    int j;
+
+    for(j = 0; j < n; j += 16) {
+        __mmask16 k = n - j >= 16 ? 0xffff : (__mmask16)((1u << (n - j)) - 1);
+        __m512 s = _mm512_add_ps(va, _mm512_maskz_loadu_ps(k, b + j));
+        __m512 cj = _mm512_maskz_loadu_ps(k, c + j);
+        __mmask16 better = _mm512_mask_cmp_ps_mask(k, s, cj, _CMP_LT_OQ);
+        _mm512_mask_storeu_epi32(nc + j, better, vk);
+        _mm512_mask_storeu_ps(c + j, k, _mm512_min_ps(cj, s));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void n16_avx512(float* c, const float* b, float a, short* nc, short nk, int n)
+{
+    const __m512 va = _mm512_set1_ps(a);
+    const __m512i vk = _mm512_set1_epi32(nk);
+    int j;
+
+    for(j = 0; j < n; j += 16) {
+        __mmask16 k = n - j >= 16 ? 0xffff : (__mmask16)((1u << (n - j)) - 1);
+        __m512 s = _mm512_add_ps(va, _mm512_maskz_loadu_ps(k, b + j));
+        __m512 cj = _mm512_maskz_loadu_ps(k, c + j);
+        __mmask16 better = _mm512_mask_cmp_ps_mask(k, s, cj, _CMP_LT_OQ);
+        // masked narrowing store, so only improved indices are written
+        _mm512_mask_cvtepi32_storeu_epi16(nc + j, better, vk);
+        _mm512_mask_storeu_ps(c + j, k, _mm512_min_ps(cj, s));
+    }
+}
+
+static minplus_f32_t kernel_f32;
+static minplus_i32_t kernel_i32;
+static minplus_u16_t kernel_u16;
+static minplus_n32_t kernel_n32;
+static minplus_n16_t kernel_n16;
+static const char*   kernel_name;
+
+/**
+ * @name     minplus_select
+ * @brief    use the named kernel (scalar, avx2 or avx512)
+ * @returns  0, or -1 if this CPU cannot run it
+ *
+ ******************************************************************************/
+int minplus_select(const char* name)
+{
+    __builtin_cpu_init();
+    if(strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+        kernel_f32 = f32_avx512;
+        kernel_i32 = i32_avx512;
+        kernel_u16 = __builtin_cpu_supports("avx512bw") ? u16_avx512 : u16_avx2;
+        kernel_n32 = n32_avx512;
+        kernel_n16 = n16_avx512;
+    } else if(strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        kernel_f32 = f32_avx2;
+        kernel_i32 = i32_avx2;
+        kernel_u16 = u16_avx2;
+        kernel_n32 = n32_avx2;
+        kernel_n16 = n16_avx2;
+    } else if(strcmp(name, "scalar") == 0) {
+        kernel_f32 = f32_scalar;
+        kernel_i32 = i32_scalar;
+        kernel_u16 = u16_scalar;
+        kernel_n32 = n32_scalar;
+        kernel_n16 = n16_scalar;
+    } else {
+        return -1;
+    }
+    kernel_name = name;
+    return 0;
+}
+
+/**
+ * @name     minplus_kernel
+ * @brief    name of the kernel in use, picking the widest one the CPU has
+ *           (or FLOYD_KERNEL) on the first call.  The engine entry points
+ *           (floyd_run, floyd_run_typed, apsp_decrease) and the drivers call
+ *           this before their first parallel region; the row wrappers below
+ *           assume a kernel is set.
+ *
+ ******************************************************************************/
+const char* minplus_kernel(void)
+{
+    const char* want = getenv("FLOYD_KERNEL");
+
+    if(kernel_name == NULL) {
+        if(!(want && minplus_select(want) == 0) &&
+           minplus_select("avx512") != 0 && minplus_select("avx2") != 0) {
+            minplus_select("scalar");
+        }
+    }
+    return kernel_name;
+}
+
+void minplus_f32(float* c, const float* b, float a, int n)
+{
+    kernel_f32(c, b, a, n);
+}
+
+void minplus_i32(int* c, const int* b, int a, int n)
+{
+    kernel_i32(c, b, a, n);
+}
+
+void minplus_u16(unsigned short* c, const unsigned short* b, unsigned short a, int n)
+{
+    kernel_u16(c, b, a, n);
+}
+
+void minplus_f32_n32(float* c, const float* b, float a, int* nc, int nk, int n)
+{
+    kernel_n32(c, b, a, nc, nk, n);
+}
+
+void minplus_f32_n16(float* c, const float* b, float a, short* nc, short nk, int n)
+{
+    kernel_n16(c, b, a, nc, nk, n);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file    minplus_bench.c
+ * @brief   single core microbenchmark of the min-plus row kernels against
+ *          the loop in kgill's floyd.c, which goes through float* row
+ *          pointers and leaves vectorizing to the compiler.  Each point
+ *          relaxes a BENCH_ROWS x n block against one row, like a tile
+ *          row of the blocked engine, and counts 2 flops per element.
+ *
+ *          usage: minplus-bench [n ...]
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "floyd.h"
+
+/* Defines */
+#define BENCH_ROWS      64
+#define BENCH_ELEMENTS  (1L << 30)      // element updates per point
+
+static double now(void)
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * @name     loop_kgill
+ * @brief    the inner loops of kgill's floyd.c for one k over `rows` rows
+ *
+ ******************************************************************************/
+static void loop_kgill(float* array[], float* tmp, int rows, int k, int n)
+{
+    unsigned i, j;
+
+    for(i = 0; i < rows; i++) {
+        for(j = 0; j < n; j++) {
+            array[i][j] = MIN(array[i][j], (array[i][k] + tmp[j]));
+        }
+    }
+}
+
+static void report(const char* kernel, const char* type, int n, double etime, long reps)
+{
+    double flops = 2.0 * BENCH_ROWS * (double)n * reps;
+    printf("%s, %s, %d, %f, %.2f\n", kernel, type, n, etime, flops / etime / 1e9);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char* kernels[] = { "scalar", "avx2", "avx512" };
+    int sizes[16] = { 256, 1024, 8192 };
+    int nsizes = 3;
+    int s, v, i, r;
+
+    if(argc > 1) {
+        for(nsizes = 0; nsizes < argc - 1 && nsizes < 16; nsizes++) {
+            sizes[nsizes] = atoi(argv[nsizes + 1]);
+        }
+    }
+
+    printf("kernel, type, n, etime, gflops\n");
+    for(s = 0; s < nsizes; s++) {
+        int n = sizes[s];
+        long reps = BENCH_ELEMENTS / ((long)BENCH_ROWS * n);
+        float* fd = (float*)malloc((size_t)BENCH_ROWS * n * sizeof(float));
+        float* fb = (float*)malloc(n * sizeof(float));
+        int* id = (int*)malloc((size_t)BENCH_ROWS * n * sizeof(int));
+        int* ib = (int*)malloc(n * sizeof(int));
+        unsigned short* ud = (unsigned short*)malloc((size_t)BENCH_ROWS * n * sizeof(unsigned short));
+        unsigned short* ub = (unsigned short*)malloc(n * sizeof(unsigned short));
+        float* rows[BENCH_ROWS];
+        double t;
+
+        if(reps < 1) reps = 1;
+        for(i = 0; i < BENCH_ROWS * n; i++) {
+            fd[i] = id[i] = ud[i] = 1000 + i % 977;
+        }
+        for(i = 0; i < n; i++) {
+            fb[i] = ib[i] = ub[i] = i % 1013;
+        }
+        for(i = 0; i < BENCH_ROWS; i++) {
+            rows[i] = fd + (size_t)i * n;
+        }
+
+        t = now();
+        for(r = 0; r < reps; r++) {
+            loop_kgill(rows, fb, BENCH_ROWS, r % n, n);
+        }
+        report("kgill-loop", "float", n, now() - t, reps);
+
+        for(v = 0; v < 3; v++) {
+            if(minplus_select(kernels[v]) != 0) continue;
+
+            t = now();
+            for(r = 0; r < reps; r++) {
+                for(i = 0; i < BENCH_ROWS; i++) {
+                    minplus_f32(fd + (size_t)i * n, fb, fd[(size_t)i * n + r % n], n);
+                }
+            }
+            report(kernels[v], "float", n, now() - t, reps);
+
+            t = now();
+            for(r = 0; r < reps; r++) {
+                for(i = 0; i < BENCH_ROWS; i++) {
+                    minplus_i32(id + (size_t)i * n, ib, id[(size_t)i * n + r % n], n);
+                }
+            }
+            report(kernels[v], "int32", n, now() - t, reps);
+
+            t = now();
+            for(r = 0; r < reps; r++) {
+                for(i = 0; i < BENCH_ROWS; i++) {
+                    minplus_u16(ud + (size_t)i * n, ub, ud[(size_t)i * n + r % n], n);
+                }
+            }
+            report(kernels[v], "uint16", n, now() - t, reps);
+        }
+
+        free(fd);
+        free(fb);
+        free(id);
+        free(ib);
+        free(ud);
+        free(ub);
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+#
+# Strong scaling of floyd-mpi on one box: 1D blocking broadcast, 1D
+# lookahead pipeline, 2D checkerboard and per source Dijkstra, best of ITERS
+# runs per point.
+#
+#   [MPIRUN="mpirun --oversubscribe"] ./mpi_bench.sh [size] [ranks]
+
+SIZE=${1:-4096}
+RANKS=${2:-"2 4 8 16"}
+ITERS=$(seq 1 3)
+MPIRUN=${MPIRUN:-mpirun}
+
+echo "matrix_dim, procs, algorithm, etime, flops"
+for P in ${RANKS}
+do
+    for ALGO in bcast pipeline checkerboard dijkstra
+    do
+        BEST=""
+        for ITER in ${ITERS}
+        do
+            T=$(${MPIRUN} -n ${P} ./floyd-mpi -n ${SIZE} -a ${ALGO} | awk -F', ' '{ print $2 }')
+            BEST=$(awk -v a=${T} -v b=${BEST:-${T}} 'BEGIN { print (a < b) ? a : b }')
+        done
+        awk -v n=${SIZE} -v p=${P} -v a=${ALGO} -v t=${BEST} \
+            'BEGIN { printf "%d, %d, %s, %f, %f\n", n, p, a, t, 2.0 * n * n * n / t }'
+    done
+done
@@ -0,0 +1,92 @@
+/**
+ * @file    path.c
+ * @brief   next hop matrices and path queries.  The engines keep
+ *          next[u][v] up to date in their inner loop: when going through k
+ *          shortens u -> v, the first hop becomes the first hop towards k.
+ *          Indices are int16 when n allows it, halving the extra traffic
+ *          compared with int32.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "floyd.h"
+
+#define NEXT(p,u,v) ((p)->width == 2 ? ((short*)(p)->next)[(size_t)(u)*(p)->n + (v)] \
+                                     : ((int*)(p)->next)[(size_t)(u)*(p)->n + (v)])
+
+/**
+ * @name     next_create
+ * @brief    next hop matrix for the edges of d, before any relaxation:
+ *           v where there is an edge u -> v, u on the diagonal, else -1
+ * @param
+ *       @name   width
+ *       @dir    I
+ *       @type   int
+ *       @brief  bytes per index, 2 or 4; 2 needs n <= 32767
+ *
+ ******************************************************************************/
+floyd_next_t* next_create(const float* d, int n, int width)
+{
+    floyd_next_t* p = (floyd_next_t*)malloc(sizeof(floyd_next_t));
+    int u, v;
+
+    if(width == 2 && n > SHRT_MAX) {
+        fprintf(stderr, "next_create: %d vertices do not fit int16 indices\n", n);
+        exit(1);
+    }
+    p->n = n;
+    p->width = width;
+    p->next = malloc((size_t)n * n * width);
+    if(p->next == NULL) {
+        fprintf(stderr, "next_create: out of memory\n");
+        exit(1);
+    }
+
+    #pragma omp parallel for private(v) schedule(static)
+    for(u = 0; u < n; u++) {
+        for(v = 0; v < n; v++) {
+            int hop = u == v ? u : d[(size_t)u*n + v] < FLOYD_INF ? v : -1;
+            if(width == 2) {
+                ((short*)p->next)[(size_t)u*n + v] = hop;
+            } else {
+                ((int*)p->next)[(size_t)u*n + v] = hop;
+            }
+        }
+    }
+    return p;
+}
+
+void next_free(floyd_next_t* p)
+{
+    free(p->next);
+    free(p);
+}
+
+size_t next_bytes(const floyd_next_t* p)
+{
+    return (size_t)p->n * p->n * p->width;
+}
+
+/**
+ * @name     floyd_path
+ * @brief    vertices of a shortest path from u to v, both included
+ * @returns  the number written to path, 0 if v is unreachable from u, -1 if
+ *           the path is longer than max
+ *
+ ******************************************************************************/
+int floyd_path(const floyd_next_t* p, int u, int v, int* path, int max)
+{
+    int len = 0;
+
+    if(NEXT(p, u, v) < 0) return 0;
+    while(len < max) {
+        path[len++] = u;
+        if(u == v) return len;
+        u = NEXT(p, u, v);
+    }
+    return -1;
+}
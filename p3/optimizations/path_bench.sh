@@ -0,0 +1,34 @@
+#!/bin/bash
+#
+# Cost of path reconstruction: runs floyd-omp distance only and with int32
+# and int16 next hop matrices, and prints the time, the slowdown over the
+# distance only run and the total matrix memory.
+#
+#   ./path_bench.sh [sizes] [algorithm]
+
+SIZES=${1:-"1024 2048 4096"}
+ALGO=${2:-blocked}
+ITERS=$(seq 1 3)
+
+echo "matrix_dim, index_bits, etime, slowdown, matrix_mb"
+for SIZE in ${SIZES}
+do
+    BASE=""
+    for BITS in 0 32 16
+    do
+        FLAG=""
+        [ ${BITS} -ne 0 ] && FLAG="-p ${BITS}"
+
+        # best of ITERS runs
+        BEST=""
+        for ITER in ${ITERS}
+        do
+            T=$(./floyd-omp -n ${SIZE} -a ${ALGO} ${FLAG} 2>/dev/null | awk -F', ' '{ print $2 }')
+            BEST=$(awk -v a=${T} -v b=${BEST:-${T}} 'BEGIN { print (a < b) ? a : b }')
+        done
+        BASE=${BASE:-${BEST}}
+
+        awk -v n=${SIZE} -v bits=${BITS} -v t=${BEST} -v base=${BASE} \
+            'BEGIN { printf "%d, %d, %f, %.3f, %.1f\n", n, bits, t, t / base, n * n * (4 + bits / 8) / 1e6 }'
+    done
+done
@@ -0,0 +1,32 @@
+#!/bin/bash
+#
+# Recursive against tiled Floyd: runs floyd-omp on the tridiagonal test
+# with the naive loop, blocked Floyd at a spread of tile sizes and the
+# R-Kleene engine, which has no tile size, and prints the time and rate of
+# each.  Naive at 8192 takes a while.
+#
+#   ./rkleene_bench.sh [sizes] [tiles]
+
+SIZES=${1:-"8192"}
+TILES=${2:-"16 64 256"}
+
+echo "matrix_dim, algorithm, tile, etime, gflops"
+for SIZE in ${SIZES}
+do
+    RUNS="naive:0 rkleene:0"
+    for TILE in ${TILES}
+    do
+        RUNS="${RUNS} blocked:${TILE}"
+    done
+
+    for RUN in ${RUNS}
+    do
+        ALGO=${RUN%:*}
+        TILE=${RUN#*:}
+        FLAG=""
+        [ ${TILE} -ne 0 ] && FLAG="-b ${TILE}"
+
+        ./floyd-omp -n ${SIZE} -a ${ALGO} ${FLAG} 2>/dev/null | \
+            awk -F', ' -v a=${ALGO} -v b=${TILE} '{ printf "%d, %s, %d, %f, %.2f\n", $1, a, b, $2, $3 / 1e9 }'
+    done
+done
@@ -0,0 +1,335 @@
+/**
+ * @file    sparse.c
+ * @brief   sparse all pairs shortest paths: the graph in CSR form and one
+ *          Dijkstra per source with an indexed binary heap.  Sources are
+ *          independent, so the OpenMP threads (and the MPI ranks, each on
+ *          its own block of sources) share them out with no communication.
+ *          O(n (m + n) log n) instead of Floyd's n^3, which wins when the
+ *          graph has far fewer than n^2 edges.
+ *
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "floyd.h"
+
+/**
+ * @name     csr_alloc
+ * @brief    CSR graph with room for m edges
+ *
+ ******************************************************************************/
+csr_t* csr_alloc(int n, long m)
+{
+    csr_t* g = (csr_t*)malloc(sizeof(csr_t));
+
+    g->n = n;
+    g->m = m;
+    g->row = (long*)malloc((n + 1) * sizeof(long));
+    g->col = (int*)malloc(MAX(m, 1) * sizeof(int));
+    g->w = (float*)malloc(MAX(m, 1) * sizeof(float));
+    if(g->row == NULL || g->col == NULL || g->w == NULL) {
+        fprintf(stderr, "csr_alloc: out of memory\n");
+        exit(1);
+    }
+    return g;
+}
+
+void csr_free(csr_t* g)
+{
+    free(g->row);
+    free(g->col);
+    free(g->w);
+    free(g);
+}
+
+/**
+ * @name     csr_from_dense
+ * @brief    the finite off-diagonal entries of d as a CSR graph
+ *
+ ******************************************************************************/
+csr_t* csr_from_dense(const float* d, int n)
+{
+    long m = 0, e;
+    int u, v;
+
+    for(u = 0; u < n; u++) {
+        for(v = 0; v < n; v++) {
+            if(u != v && d[(size_t)u*n + v] < FLOYD_INF) m++;
+        }
+    }
+
+    csr_t* g = csr_alloc(n, m);
+    for(u = 0, e = 0; u < n; u++) {
+        g->row[u] = e;
+        for(v = 0; v < n; v++) {
+            if(u != v && d[(size_t)u*n + v] < FLOYD_INF) {
+                g->col[e] = v;
+                g->w[e++] = d[(size_t)u*n + v];
+            }
+        }
+    }
+    g->row[n] = e;
+    return g;
+}
+
+/**
+ * @name     csr_tridiagonal
+ * @brief    the tridiagonal test graph built straight into CSR form
+ *
+ ******************************************************************************/
+csr_t* csr_tridiagonal(int n)
+{
+    csr_t* g = csr_alloc(n, 2L * (n - 1));
+    long e = 0;
+    int u;
+
+    for(u = 0; u < n; u++) {
+        g->row[u] = e;
+        if(u > 0)     { g->col[e] = u - 1; g->w[e++] = 1; }
+        if(u < n - 1) { g->col[e] = u + 1; g->w[e++] = 1; }
+    }
+    g->row[n] = e;
+    return g;
+}
+
+/**
+ * @name     graph_density
+ * @brief    fraction of the n (n-1) possible edges that d has
+ *
+ ******************************************************************************/
+double graph_density(const float* d, int n)
+{
+    long m = 0;
+    int u, v;
+
+    #pragma omp parallel for private(v) reduction(+:m) schedule(static)
+    for(u = 0; u < n; u++) {
+        for(v = 0; v < n; v++) {
+            if(u != v && d[(size_t)u*n + v] < FLOYD_INF) m++;
+        }
+    }
+    return n > 1 ? (double)m / ((double)n * (n - 1)) : 1.0;
+}
+
+/* indexed binary min heap on dist[], pos[v] is v's slot or -1 */
+typedef struct {
+    int  size;
+    int* heap;
+    int* pos;
+} heap_t;
+
+static void heap_up(heap_t* h, const float* dist, int i)
+{
+    int v = h->heap[i];
+
+    while(i > 0 && dist[h->heap[(i - 1) / 2]] > dist[v]) {
+        h->heap[i] = h->heap[(i - 1) / 2];
+        h->pos[h->heap[i]] = i;
+        i = (i - 1) / 2;
+    }
+    h->heap[i] = v;
+    h->pos[v] = i;
+}
+
+static int heap_pop(heap_t* h, const float* dist)
+{
+    int top = h->heap[0];
+    int v = h->heap[--h->size];
+    int i = 0;
+
+    h->pos[top] = -1;
+    if(h->size == 0) return top;
+
+    for(;;) {
+        int c = 2 * i + 1;
+        if(c >= h->size) break;
+        if(c + 1 < h->size && dist[h->heap[c + 1]] < dist[h->heap[c]]) c++;
+        if(dist[h->heap[c]] >= dist[v]) break;
+        h->heap[i] = h->heap[c];
+        h->pos[h->heap[i]] = i;
+        i = c;
+    }
+    h->heap[i] = v;
+    h->pos[v] = i;
+    return top;
+}
+
+/**
+ * @name     dijkstra_rows
+ * @brief    shortest path rows for sources s0 .. s1-1
+ * @param
+ *       @name   out
+ *       @dir    O
+ *       @type   float*
+ *       @brief  (s1-s0) x n distances, row 0 for source s0
+ * @param
+ *       @name   next
+ *       @dir    O
+ *       @type   floyd_next_t*
+ *       @brief  n x n next hop matrix whose rows s0 .. s1-1 are filled in,
+ *               or NULL
+ *
+ ******************************************************************************/
+void dijkstra_rows(const csr_t* g, int s0, int s1, float* out, floyd_next_t* next)
+{
+    int n = g->n;
+
+    #pragma omp parallel
+    {
+        heap_t h;
+        int* first = (int*)malloc(n * sizeof(int));     // first hop towards v
+        int s, v;
+
+        h.heap = (int*)malloc(n * sizeof(int));
+        h.pos = (int*)malloc(n * sizeof(int));
+
+        #pragma omp for schedule(dynamic, 16)
+        for(s = s0; s < s1; s++) {
+            float* dist = out + (size_t)(s - s0) * n;
+
+            for(v = 0; v < n; v++) {
+                dist[v] = FLOYD_INF;
+                h.pos[v] = -1;
+                first[v] = -1;
+            }
+            dist[s] = 0;
+            first[s] = s;
+            h.heap[0] = s;
+            h.pos[s] = 0;
+            h.size = 1;
+
+            while(h.size > 0) {
+                int u = heap_pop(&h, dist);
+                long e;
+
+                for(e = g->row[u]; e < g->row[u + 1]; e++) {
+                    int w = g->col[e];
+                    float alt = dist[u] + g->w[e];
+
+                    if(alt < dist[w]) {
+                        int fresh = dist[w] == FLOYD_INF && h.pos[w] < 0;
+                        dist[w] = alt;
+                        first[w] = u == s ? w : first[u];
+                        if(fresh) {
+                            h.heap[h.size] = w;
+                            h.pos[w] = h.size++;
+                        }
+                        heap_up(&h, dist, h.pos[w]);
+                    }
+                }
+            }
+
+            if(next != NULL) {
+                for(v = 0; v < n; v++) {
+                    if(next->width == 2) {
+                        ((short*)next->next)[(size_t)s*n + v] = first[v];
+                    } else {
+                        ((int*)next->next)[(size_t)s*n + v] = first[v];
+                    }
+                }
+            }
+        }
+
+        free(first);
+        free(h.heap);
+        free(h.pos);
+    }
+}
+
+/**
+ * @name     csr_transpose
+ * @brief    the graph with every edge reversed, so row v lists the edges
+ *           into v
+ *
+ ******************************************************************************/
+csr_t* csr_transpose(const csr_t* g)
+{
+    csr_t* t = csr_alloc(g->n, g->m);
+    long* fill = (long*)calloc(g->n + 1, sizeof(long));
+    long e;
+    int u;
+
+    for(e = 0; e < g->m; e++) {
+        fill[g->col[e] + 1]++;
+    }
+    for(u = 0; u < g->n; u++) {
+        fill[u + 1] += fill[u];
+    }
+    memcpy(t->row, fill, (g->n + 1) * sizeof(long));
+    for(u = 0; u < g->n; u++) {
+        for(e = g->row[u]; e < g->row[u + 1]; e++) {
+            long f = fill[g->col[e]]++;
+            t->col[f] = u;
+            t->w[f] = g->w[e];
+        }
+    }
+    free(fill);
+    return t;
+}
+
+/**
+ * @name     dijkstra_repair
+ * @brief    redo the shortest path row of source s for just the vertices
+ *           marked stale, the rest of row being right already: each stale
+ *           vertex starts from its best edge in from a vertex that is not
+ *           stale, then Dijkstra runs among the stale ones.  The cost goes
+ *           with the stale vertices and their edges, not with n.
+ * @param
+ *       @name   gt
+ *       @dir    I
+ *       @type   const csr_t*
+ *       @brief  csr_transpose(g)
+ *
+ ******************************************************************************/
+void dijkstra_repair(const csr_t* g, const csr_t* gt, int s, float* row, const char* stale)
+{
+    int n = g->n;
+    heap_t h;
+    int v;
+
+    h.heap = (int*)malloc(n * sizeof(int));
+    h.pos = (int*)malloc(n * sizeof(int));
+    h.size = 0;
+
+    for(v = 0; v < n; v++) {
+        long e;
+
+        h.pos[v] = -1;
+        if(!stale[v] || v == s) continue;
+        row[v] = FLOYD_INF;
+        for(e = gt->row[v]; e < gt->row[v + 1]; e++) {
+            int k = gt->col[e];
+            if(!stale[k]) row[v] = MIN(row[v], row[k] + gt->w[e]);
+        }
+        if(row[v] < FLOYD_INF) {
+            h.heap[h.size] = v;
+            h.pos[v] = h.size++;
+            heap_up(&h, row, h.pos[v]);
+        }
+    }
+
+    while(h.size > 0) {
+        int u = heap_pop(&h, row);
+        long e;
+
+        for(e = g->row[u]; e < g->row[u + 1]; e++) {
+            int w = g->col[e];
+            float alt = row[u] + g->w[e];
+
+            if(stale[w] && w != s && alt < row[w]) {
+                row[w] = alt;
+                if(h.pos[w] < 0) {
+                    h.heap[h.size] = w;
+                    h.pos[w] = h.size++;
+                }
+                heap_up(&h, row, h.pos[w]);
+            }
+        }
+    }
+
+    free(h.heap);
+    free(h.pos);
+}